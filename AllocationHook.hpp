@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdlib>
+#include <new>
+
+#include "PerformanceTracer.hpp" // For note_allocation
+
+// Replacements of the global allocation functions that report every allocation to the
+// tracer: the calling thread's totals (PerformanceTracer::thread_allocations) and, inside a
+// traced scope, the scope's call-tree node.
+//
+// Replacement functions may only be defined once per program, so include this header in
+// exactly one translation unit: the one holding main(). The bench binary always does; the
+// test binary does when built with ALLOC=1 (-DENABLE_ALLOCATION_TRACKING).
+
+namespace PerformanceTracer {
+
+inline const bool allocation_hook_registered = (allocation_hook_installed.store(true), true);
+
+// The deletes below free memory the news above took from malloc. Out of line, so that
+// GCC, which pairs new with delete wherever both are inlined, does not mistake that for a
+// mismatched deallocation (-Wmismatched-new-delete).
+[[gnu::noinline]] inline void raw_free(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+} // namespace PerformanceTracer
+
+void* operator new(std::size_t size) {
+    PerformanceTracer::note_allocation(size);
+    if (void* pointer = std::malloc(size ? size : 1)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    PerformanceTracer::note_allocation(size);
+    std::size_t align = static_cast<std::size_t>(alignment);
+    // aligned_alloc wants a multiple of the alignment.
+    if (void* pointer = std::aligned_alloc(align, (size + align - 1) / align * align)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+    PerformanceTracer::raw_free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+    PerformanceTracer::raw_free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+    PerformanceTracer::raw_free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept {
+    PerformanceTracer::raw_free(pointer);
+}
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <optional>
+
+#include "Board.hpp"             // For BoardState, GameSet
+#include "MoveFinder.hpp"        // For find_best_move
+#include "ThreadPool.hpp"        // For running a batch of positions across all cores
+#include "PerformanceTracer.hpp" // For TRACE_FUNCTION
+
+// Batch position analysis.
+//
+// Input is one position per line:  <board> ; <hand>
+// The board lists sets separated by '|', and each set lists its tiles separated by spaces.
+// Tiles use Tile::toString form ("R7", "B13'"). Blank lines and lines starting with '#'
+// are skipped. Example:  R1 R2 R3 | B4 R4 Y4 ; R5 Y10 Y11 Y12
+//
+// Output is one tab-separated line per position, in input order:
+//   <line number> <tiles played> <new board> <remaining hand> <microseconds>
+// The board and hand use the input syntax, so a result can be fed straight back in.
+// A position that fails to parse gives "<line number> error <message>".
+namespace Analyzer {
+
+struct Position {
+    BoardState board;
+    std::vector<Tile> hand;
+};
+
+inline bool parse_tiles(const std::string& text, std::vector<Tile>& tiles, std::string& error) {
+    std::istringstream words(text);
+    std::string word;
+    while (words >> word) {
+        std::optional<Tile> tile = Tile::fromString(word);
+        if (!tile) {
+            error = "bad tile '" + word + "'";
+            return false;
+        }
+        tiles.push_back(*tile);
+    }
+    return true;
+}
+
+inline std::optional<Position> parse_position(const std::string& line, std::string& error) {
+    size_t separator = line.find(';');
+    if (separator == std::string::npos) {
+        error = "missing ';' between board and hand";
+        return std::nullopt;
+    }
+
+    Position position;
+    std::vector<GameSet> sets;
+    std::istringstream board_text(line.substr(0, separator));
+    std::string set_text;
+    while (std::getline(board_text, set_text, '|')) {
+        std::vector<Tile> tiles;
+        if (!parse_tiles(set_text, tiles, error)) {
+            return std::nullopt;
+        }
+        if (tiles.empty()) {
+            continue;
+        }
+        sets.push_back(GameSet(tiles, isValidRun(tiles) ? SetType::RUN : SetType::GROUP));
+    }
+    position.board = BoardState(sets);
+
+    if (!parse_tiles(line.substr(separator + 1), position.hand, error)) {
+        return std::nullopt;
+    }
+    return position;
+}
+
+inline std::string format_tiles(const std::vector<Tile>& tiles) {
+    std::string text;
+    for (const auto& tile : tiles) {
+        if (!text.empty()) {
+            text += ' ';
+        }
+        text += tile.toString();
+    }
+    return text;
+}
+
+inline std::string format_board(const BoardState& board) {
+    std::string text;
+    for (const auto& set : board.sets) {
+        if (!text.empty()) {
+            text += " | ";
+        }
+        text += format_tiles(set.tiles);
+    }
+    return text;
+}
+
+// Analyzes one input line and returns its output line (without the newline).
+inline std::string analyze_line(const std::string& line, size_t line_number) {
+    std::ostringstream out;
+    out << line_number << '\t';
+
+    std::string error;
+    std::optional<Position> position = parse_position(line, error);
+    if (!position) {
+        out << "error\t" << error;
+        return out.str();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::optional<Move> move = MoveFinder::find_best_move(position->board, position->hand);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    double micros = std::chrono::duration<double, std::micro>(elapsed).count();
+
+    std::vector<Tile> hand = position->hand;
+    std::sort(hand.begin(), hand.end());
+    if (move) {
+        out << move->tiles_played_count << '\t' << format_board(move->new_board_state) << '\t'
+            << format_tiles(move->remaining_hand);
+    } else {
+        out << 0 << '\t' << format_board(position->board) << '\t' << format_tiles(hand);
+    }
+    out << '\t' << std::fixed << std::setprecision(1) << micros;
+    return out.str();
+}
+
+inline bool is_record(const std::string& line) {
+    size_t first = line.find_first_not_of(" \t\r");
+    return first != std::string::npos && line[first] != '#';
+}
+
+// Streams positions from `in` to `out`. Lines are read in batches of `batch_size`; each
+// batch is analyzed in parallel and written in input order before the next is read, so
+// memory stays bounded on arbitrarily long inputs. Returns the number of records analyzed.
+inline size_t run(std::istream& in, std::ostream& out, ThreadPool& pool = ThreadPool::instance(),
+                  size_t batch_size = 4096) {
+    TRACE_FUNCTION();
+    std::vector<std::string> lines;
+    std::vector<size_t> line_numbers;
+    std::vector<std::string> results;
+    size_t line_number = 0;
+    size_t records = 0;
+    std::string line;
+
+    bool more = true;
+    while (more) {
+        lines.clear();
+        line_numbers.clear();
+        while (lines.size() < batch_size && (more = static_cast<bool>(std::getline(in, line)))) {
+            ++line_number;
+            if (is_record(line)) {
+                lines.push_back(line);
+                line_numbers.push_back(line_number);
+            }
+        }
+
+        results.assign(lines.size(), std::string());
+        pool.parallel_for(lines.size(), 1, [&](size_t i) {
+            results[i] = analyze_line(lines[i], line_numbers[i]);
+        });
+        for (const auto& result : results) {
+            out << result << '\n';
+        }
+        out.flush();
+        records += lines.size();
+    }
+    return records;
+}
+
+} // namespace Analyzer
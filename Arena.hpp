@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>          // For std::unique_ptr
+#include <memory_resource> // For std::pmr::memory_resource
+#include <algorithm>       // For std::max
+#include <new>             // For std::max_align_t
+
+// Bump allocator for memory that lives no longer than one search.
+//
+// The arena hands out memory from one buffer, allocated once, by bumping an offset;
+// deallocate does nothing. A Scope remembers the offset when it opens and rewinds to it
+// when it closes, releasing everything allocated inside in one step. Scopes nest like
+// stack frames, so two rules keep them sound:
+//   - nothing allocated inside a scope may outlive it, and
+//   - a container created outside a scope must not grow inside it.
+// Search results that escape (BoardState, GameSet) therefore stay on the heap; the arena
+// only backs the search's own temporaries, through std::pmr containers.
+//
+// Memory is bounded by the buffer: once it is full, allocations fall back to the heap and
+// are freed when the outermost scope closes. peak_bytes() and overflows() report how close
+// searches come to the capacity, so it can be sized from a benchmark run.
+class Arena : public std::pmr::memory_resource {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = size_t(64) << 10;
+
+    class Scope {
+    public:
+        explicit Scope(Arena& arena = Arena::local())
+            : arena_(arena), mark_(arena.offset_) {
+            ++arena_.depth_;
+        }
+
+        ~Scope() {
+            arena_.offset_ = mark_;
+            if (--arena_.depth_ == 0) {
+                arena_.release_overflow();
+            }
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        std::pmr::memory_resource* resource() const {
+            return &arena_;
+        }
+
+    private:
+        Arena& arena_;
+        size_t mark_;
+    };
+
+    explicit Arena(size_t capacity = DEFAULT_CAPACITY)
+        : buffer_(new std::byte[capacity]), capacity_(capacity) {}
+
+    ~Arena() override {
+        release_overflow();
+    }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Per-thread arena, so concurrent searches never share a buffer.
+    static Arena& local() {
+        static thread_local Arena arena;
+        return arena;
+    }
+
+    size_t capacity() const {
+        return capacity_;
+    }
+
+    // Bytes handed out and not yet released, counting heap fallbacks.
+    size_t bytes_in_use() const {
+        return offset_ + overflow_bytes_;
+    }
+
+    // Largest bytes_in_use() since construction or the last reset_peak().
+    size_t peak_bytes() const {
+        return peak_;
+    }
+
+    // Allocations that did not fit in the buffer.
+    uint64_t overflows() const {
+        return overflows_;
+    }
+
+    void reset_peak() {
+        peak_ = bytes_in_use();
+        overflows_ = 0;
+    }
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        size_t start = (offset_ + alignment - 1) & ~(alignment - 1);
+        if (start + bytes <= capacity_) {
+            offset_ = start + bytes;
+            peak_ = std::max(peak_, bytes_in_use());
+            return buffer_.get() + start;
+        }
+        return allocate_overflow(bytes, alignment);
+    }
+
+    void do_deallocate(void*, size_t, size_t) override {
+        // Released when the enclosing scope closes.
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+private:
+    // Heap block that did not fit; chained so the outermost scope can free them all.
+    struct Overflow {
+        Overflow* next;
+        size_t alignment;
+    };
+
+    void* allocate_overflow(size_t bytes, size_t alignment) {
+        size_t align = std::max(alignment, alignof(std::max_align_t));
+        size_t header = (sizeof(Overflow) + align - 1) / align * align;
+        std::byte* block = static_cast<std::byte*>(::operator new(header + bytes, std::align_val_t(align)));
+        overflow_ = new (block) Overflow{overflow_, align};
+        overflow_bytes_ += header + bytes;
+        ++overflows_;
+        peak_ = std::max(peak_, bytes_in_use());
+        return block + header;
+    }
+
+    void release_overflow() {
+        while (overflow_) {
+            Overflow* next = overflow_->next;
+            ::operator delete(overflow_, std::align_val_t(overflow_->alignment));
+            overflow_ = next;
+        }
+        overflow_bytes_ = 0;
+    }
+
+    std::unique_ptr<std::byte[]> buffer_;
+    size_t capacity_;
+    size_t offset_ = 0;
+    int depth_ = 0;
+    Overflow* overflow_ = nullptr;
+    size_t overflow_bytes_ = 0;
+    size_t peak_ = 0;
+    uint64_t overflows_ = 0;
+};
@@ -0,0 +1,782 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <chrono>                // For Budget's deadline
+#include <atomic>                // For Budget's cancel flag
+#include <memory_resource>       // For the arena-backed scratch containers
+#include "GameTypes.hpp"         // For GameSet, SetType, Tile
+#include "SetFinder.hpp"         // For the set catalog used by solve_canonical
+#include "PerformanceTracer.hpp" // For performance tracing
+#include "Arena.hpp"             // For search-scoped scratch memory
+#include "ThreadPool.hpp"        // For solve_canonical's parallel probes
+
+// Dynamic-programming arrangement solver.
+//
+// Sweeps numbers 1..13 once. The state after number v records, for each color, the
+// lengths of the (at most two) runs still open through v, capped at 3 ("long enough to
+// close"). Because there are only two copies of every tile, at most two runs of one color
+// can pass through any number, so a color needs two slots and the unordered slot pair has
+// 10 values: 10^4 states per number. Tiles of number v that do not extend or start a run
+// must form groups at v, which is a table lookup on the per-color leftover counts.
+// The work is therefore linear in the number of values, independent of how many tiles
+// are on the table.
+//
+// Jokers are wildcard slots: the state also counts the jokers placed so far, and at each
+// number a joker may stand in as one more tile of any color (as long as that kind still
+// totals at most two). A joker never has to be tried as each of the 52 tiles separately;
+// with two jokers the state space is at most three times larger.
+namespace ArrangementSolver {
+
+constexpr int JOKER_SLOT = TileCode::NUM_KINDS; // PoolCounts entry holding the joker count.
+
+using PoolCounts = std::array<uint8_t, TileCode::NUM_KINDS + 1>;
+
+constexpr int MAX_COPIES = 2;
+constexpr int MAX_JOKERS = TileCode::NUM_JOKERS;
+constexpr int RUN_CAP = 3;
+constexpr int NUM_SLOT_PAIRS = 10;
+constexpr int NUM_SLOT_STATES = NUM_SLOT_PAIRS * NUM_SLOT_PAIRS * NUM_SLOT_PAIRS * NUM_SLOT_PAIRS;
+constexpr int NUM_STATES = NUM_SLOT_STATES * (MAX_JOKERS + 1);
+constexpr int NUM_LEFTOVER_CODES = 81; // 3^4: 0..2 leftover tiles per color
+
+struct SlotPair {
+    uint8_t low;
+    uint8_t high;
+};
+
+constexpr std::array<SlotPair, NUM_SLOT_PAIRS> make_slot_pairs() {
+    std::array<SlotPair, NUM_SLOT_PAIRS> pairs{};
+    int n = 0;
+    for (int low = 0; low <= RUN_CAP; ++low) {
+        for (int high = low; high <= RUN_CAP; ++high) {
+            pairs[n++] = {static_cast<uint8_t>(low), static_cast<uint8_t>(high)};
+        }
+    }
+    return pairs;
+}
+
+inline constexpr std::array<SlotPair, NUM_SLOT_PAIRS> SLOT_PAIRS = make_slot_pairs();
+
+constexpr int pair_index(int a, int b) {
+    int low = a < b ? a : b;
+    int high = a < b ? b : a;
+    // Pairs are enumerated row by row: row `low` starts after sum_{i<low} (4 - i) entries.
+    return low * (RUN_CAP + 1) - low * (low - 1) / 2 + (high - low);
+}
+
+constexpr bool pair_closable(int p) {
+    return (SLOT_PAIRS[p].low == 0 || SLOT_PAIRS[p].low == RUN_CAP) &&
+           (SLOT_PAIRS[p].high == 0 || SLOT_PAIRS[p].high == RUN_CAP);
+}
+
+constexpr int open_slots(int p) {
+    return (SLOT_PAIRS[p].low != 0) + (SLOT_PAIRS[p].high != 0);
+}
+
+// What one color can do at one number: the resulting slot pair and how many of its
+// tiles are left over for groups. Every non-empty slot after the step holds a tile of
+// this number, so the tiles sent to runs always equal open_slots(next_pair).
+struct ColorOption {
+    uint8_t next_pair;
+    uint8_t to_groups;
+};
+
+struct OptionList {
+    ColorOption options[8];
+    uint8_t count;
+};
+
+constexpr std::array<std::array<OptionList, MAX_COPIES + 1>, NUM_SLOT_PAIRS> make_transitions() {
+    std::array<std::array<OptionList, MAX_COPIES + 1>, NUM_SLOT_PAIRS> table{};
+    for (int p = 0; p < NUM_SLOT_PAIRS; ++p) {
+        int lens[2] = {SLOT_PAIRS[p].low, SLOT_PAIRS[p].high};
+        for (int k = 0; k <= MAX_COPIES; ++k) {
+            OptionList& list = table[p][k];
+            // Each slot: empty slots may stay empty or start a run, open slots extend,
+            // and slots of length 3+ may also close. Closing and restarting in the same
+            // number is never needed: extending the run dominates it.
+            int next[2][2] = {};
+            int choices[2] = {};
+            for (int s = 0; s < 2; ++s) {
+                if (lens[s] == 0) {
+                    next[s][choices[s]++] = 0;
+                    next[s][choices[s]++] = 1;
+                } else {
+                    next[s][choices[s]++] = lens[s] + 1 > RUN_CAP ? RUN_CAP : lens[s] + 1;
+                    if (lens[s] == RUN_CAP) {
+                        next[s][choices[s]++] = 0;
+                    }
+                }
+            }
+            for (int i = 0; i < choices[0]; ++i) {
+                for (int j = 0; j < choices[1]; ++j) {
+                    int np = pair_index(next[0][i], next[1][j]);
+                    int used = open_slots(np);
+                    if (used > k) {
+                        continue;
+                    }
+                    ColorOption option = {static_cast<uint8_t>(np), static_cast<uint8_t>(k - used)};
+                    bool duplicate = false;
+                    for (int o = 0; o < list.count; ++o) {
+                        duplicate |= list.options[o].next_pair == option.next_pair &&
+                                     list.options[o].to_groups == option.to_groups;
+                    }
+                    if (!duplicate) {
+                        list.options[list.count++] = option;
+                    }
+                }
+            }
+        }
+    }
+    return table;
+}
+
+inline constexpr std::array<std::array<OptionList, MAX_COPIES + 1>, NUM_SLOT_PAIRS> TRANSITIONS = make_transitions();
+
+// Whether per-color leftover counts (0..2 each, base-3 code) split into groups of 3 or 4
+// distinct colors. A color with two leftovers forces two groups that both contain it.
+constexpr std::array<bool, NUM_LEFTOVER_CODES> make_group_table() {
+    std::array<bool, NUM_LEFTOVER_CODES> table{};
+    for (int code = 0; code < NUM_LEFTOVER_CODES; ++code) {
+        int singles = 0, doubles = 0;
+        for (int c = 0, rest = code; c < TileCode::NUM_COLORS; ++c, rest /= 3) {
+            singles += rest % 3 == 1;
+            doubles += rest % 3 == 2;
+        }
+        if (doubles == 0) {
+            table[code] = singles == 0 || singles >= 3;
+        } else {
+            table[code] = doubles + singles / 2 >= 3;
+        }
+    }
+    return table;
+}
+
+inline constexpr std::array<bool, NUM_LEFTOVER_CODES> GROUP_OK = make_group_table();
+
+constexpr int POW3[TileCode::NUM_COLORS] = {1, 3, 9, 27};
+constexpr int POW10[TileCode::NUM_COLORS] = {1, 10, 100, 1000};
+
+inline int state_pair(int state, int c) {
+    return state / POW10[c] % NUM_SLOT_PAIRS;
+}
+
+inline int state_jokers(int state) {
+    return state / NUM_SLOT_STATES;
+}
+
+inline bool state_closable(int state) {
+    for (int c = 0; c < TileCode::NUM_COLORS; ++c) {
+        if (!pair_closable(state_pair(state, c))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// PoolCounts entry for a tile: its kind, JOKER_SLOT for a joker, or -1 if it can never
+// be placed.
+inline int count_slot(const Tile& tile) {
+    int kind = tile.getKind();
+    return TileCode::isPlayableKind(kind) ? kind : (TileCode::isJokerKind(kind) ? JOKER_SLOT : -1);
+}
+
+// Kind counts of a tile collection (jokers in JOKER_SLOT). Fails for tiles outside the 52
+// playable kinds or more than two tiles of one kind, neither of which can be arranged.
+// Tiles is any container of Tile, such as an arena-backed std::pmr::vector.
+template <typename Tiles = std::vector<Tile>>
+inline std::optional<PoolCounts> to_counts(const Tiles& tiles) {
+    PoolCounts counts{};
+    for (const auto& tile : tiles) {
+        int slot = count_slot(tile);
+        if (slot < 0 || counts[slot] == MAX_COPIES) {
+            return std::nullopt;
+        }
+        ++counts[slot];
+    }
+    return counts;
+}
+
+// Work limit for a search: a node count, a wall-clock deadline, a cancel flag set by
+// another thread, or any mix of them. A node is one DP state expanded at one number. The
+// clock is read every CLOCK_INTERVAL nodes (and before the first), so a search can run up
+// to that many nodes past the deadline before it stops; the flag is checked every node.
+// A sweep that runs out of budget reports no arrangement; exhausted() tells that apart
+// from a pool that has none. A Budget belongs to one thread.
+class Budget {
+public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr uint64_t CLOCK_INTERVAL = 256;
+
+    // max_nodes == 0 means no node limit.
+    explicit Budget(uint64_t max_nodes = 0, std::optional<Clock::time_point> deadline = std::nullopt,
+                    const std::atomic<bool>* cancel = nullptr)
+        : max_nodes_(max_nodes), deadline_(deadline), cancel_(cancel) {}
+
+    // Counts one node; false, without counting it, once the budget is spent.
+    bool spend() {
+        if (exhausted_) {
+            return false;
+        }
+        if ((max_nodes_ != 0 && nodes_ >= max_nodes_) ||
+            (cancel_ && cancel_->load(std::memory_order_relaxed)) ||
+            (deadline_ && nodes_ % CLOCK_INTERVAL == 0 && Clock::now() >= *deadline_)) {
+            exhausted_ = true;
+            return false;
+        }
+        ++nodes_;
+        return true;
+    }
+
+    uint64_t nodes() const {
+        return nodes_;
+    }
+
+    bool exhausted() const {
+        return exhausted_;
+    }
+
+private:
+    uint64_t max_nodes_;
+    std::optional<Clock::time_point> deadline_;
+    const std::atomic<bool>* cancel_;
+    uint64_t nodes_ = 0;
+    bool exhausted_ = false;
+};
+
+// Parent pointers for reconstruction: previous state, the leftover code sent to groups,
+// the per-color real tiles used at that number and the jokers standing in per color
+// (all base 3).
+struct Step {
+    uint16_t previous_state;
+    uint8_t leftover_code;
+    uint8_t used_code;
+    uint8_t joker_code;
+};
+
+// What max_playable maximizes over the optional tiles.
+enum class Objective {
+    TILES, // How many are placed.
+    POINTS // The sum of their numbers (the initial-meld value); a joker is worth the tile it
+           // stands for. Only meaningful when no jokers are required.
+};
+
+// Reachable-state sweep shared by every query. Each kind has `required` tiles that must be
+// placed and up to `optional` more that may be; the sweep keeps, per state, the best value
+// of the optional tiles placed so far. With no optional tiles this is plain feasibility.
+// Required jokers must all be placed by the end; optional ones may be.
+// A recording sweep keeps one parent entry per (number, state) for reconstruction.
+// Buffers are sized once, so a sweep reused across queries does not allocate.
+class Sweep {
+public:
+    explicit Sweep(bool record_steps) : record_steps_(record_steps) {
+        next_value_.assign(NUM_STATES, -1);
+        if (record_steps_) {
+            steps_.resize(static_cast<size_t>(TileCode::NUM_NUMBERS + 1) * NUM_STATES);
+        }
+        current_.reserve(NUM_STATES);
+        current_value_.reserve(NUM_STATES);
+        next_.reserve(NUM_STATES);
+    }
+
+    // Per-thread sweeps, so repeated queries reuse their buffers.
+    static Sweep& local(bool record_steps) {
+        static thread_local Sweep plain(false);
+        static thread_local Sweep recording(true);
+        return record_steps ? recording : plain;
+    }
+
+    // Returns the closable final state with the most optional tiles placed (ties go to the
+    // first one reached), or -1 if the required tiles cannot be arranged or `budget` ran out.
+    int run(const PoolCounts& required, const PoolCounts* optional = nullptr,
+            Objective objective = Objective::TILES, Budget* budget = nullptr) {
+        current_.assign(1, 0);
+        current_value_.assign(1, 0);
+        required_jokers_ = required[JOKER_SLOT];
+        jokers_ = required_jokers_ +
+                  (optional ? std::min<int>((*optional)[JOKER_SLOT], MAX_JOKERS - required_jokers_) : 0);
+        for (int number = 1; number <= TileCode::NUM_NUMBERS; ++number) {
+            next_.clear();
+            weight_ = objective == Objective::POINTS ? number : 1;
+            for (int c = 0; c < TileCode::NUM_COLORS; ++c) {
+                int kind = TileCode::kindOf(number, c + 1);
+                required_[c] = required[kind];
+                extra_[c] = optional ? std::min<int>((*optional)[kind], MAX_COPIES - required[kind]) : 0;
+            }
+            for (int c = 0; c < TileCode::NUM_COLORS && jokers_ > 0; ++c) {
+                joker_ok_[c] = joker_useful(required, optional, number, c);
+            }
+            number_ = number;
+            for (size_t i = 0; i < current_.size(); ++i) {
+                if (budget && !budget->spend()) {
+                    for (int state : next_) {
+                        next_value_[state] = -1; // Leave the buffers clean for the next run.
+                    }
+                    return -1;
+                }
+                from_ = current_[i];
+                from_value_ = current_value_[i];
+                expand(from_, 0, 0, 0, 0, 0, state_jokers(from_), 0);
+            }
+            current_value_.clear();
+            for (int state : next_) {
+                current_value_.push_back(next_value_[state]);
+                next_value_[state] = -1;
+            }
+            current_.swap(next_);
+            if (current_.empty()) {
+                return -1;
+            }
+        }
+        int best = -1;
+        best_value_ = -1;
+        for (size_t i = 0; i < current_.size(); ++i) {
+            if (current_value_[i] > best_value_ && state_closable(current_[i]) &&
+                state_jokers(current_[i]) >= required_jokers_) {
+                best = current_[i];
+                best_value_ = current_value_[i];
+            }
+        }
+        // Every joker placement was counted as a gain; the required ones are not optional.
+        if (best >= 0 && objective == Objective::TILES) {
+            best_value_ -= required_jokers_;
+        }
+        return best;
+    }
+
+    // Whether a joker standing in for (number, color c) can be part of any set: some window
+    // of three numbers around it, or the group at `number`, has its other two places filled
+    // by real tiles or the remaining jokers. Skipping the rest keeps jokers from seeding runs
+    // and groups that can never be completed.
+    bool joker_useful(const PoolCounts& required, const PoolCounts* optional, int number, int c) const {
+        auto available = [&](int n, int color) {
+            if (n < 1 || n > TileCode::NUM_NUMBERS) {
+                return 0;
+            }
+            int kind = TileCode::kindOf(n, color + 1);
+            return required[kind] + (optional ? (*optional)[kind] : 0) > 0 ? 1 : 0;
+        };
+        int other_jokers = jokers_ - 1;
+        for (int start = number - 2; start <= number; ++start) {
+            if (start >= 1 && start + 2 <= TileCode::NUM_NUMBERS) {
+                int real = 0;
+                for (int n = start; n <= start + 2; ++n) {
+                    real += n != number ? available(n, c) : 0;
+                }
+                if (real + other_jokers >= 2) {
+                    return true;
+                }
+            }
+        }
+        int colors = 0;
+        for (int other = 0; other < TileCode::NUM_COLORS; ++other) {
+            colors += other != c ? available(number, other) : 0;
+        }
+        return colors + other_jokers >= 2;
+    }
+
+    // Value of the optional tiles placed on the path to the state returned by run().
+    int best_value() const {
+        return best_value_;
+    }
+
+    // Parent entry of `state` at `number`; only meaningful for a recording sweep.
+    const Step& step(int number, int state) const {
+        return steps_[static_cast<size_t>(number) * NUM_STATES + state];
+    }
+
+private:
+    void expand(int state, int c, int next_state, int leftover_code, int used_code, int joker_code,
+                int jokers_used, int gain) {
+        if (c == TileCode::NUM_COLORS) {
+            next_state += jokers_used * NUM_SLOT_STATES;
+            int value = from_value_ + gain;
+            if (GROUP_OK[leftover_code] && next_value_[next_state] < value) {
+                if (next_value_[next_state] < 0) {
+                    next_.push_back(static_cast<uint16_t>(next_state));
+                }
+                next_value_[next_state] = static_cast<int16_t>(value);
+                if (record_steps_) {
+                    steps_[static_cast<size_t>(number_) * NUM_STATES + next_state] =
+                        Step{static_cast<uint16_t>(from_), static_cast<uint8_t>(leftover_code),
+                             static_cast<uint8_t>(used_code), static_cast<uint8_t>(joker_code)};
+                }
+            }
+            return;
+        }
+        int pair = state_pair(state, c);
+        for (int k = required_[c]; k <= required_[c] + extra_[c]; ++k) {
+            int max_jokers = joker_ok_[c] ? std::min(jokers_ - jokers_used, MAX_COPIES - k) : 0;
+            for (int j = 0; j <= max_jokers; ++j) {
+                const OptionList& list = TRANSITIONS[pair][k + j];
+                for (int o = 0; o < list.count; ++o) {
+                    const ColorOption& option = list.options[o];
+                    expand(state, c + 1, next_state + option.next_pair * POW10[c],
+                           leftover_code + option.to_groups * POW3[c], used_code + k * POW3[c],
+                           joker_code + j * POW3[c], jokers_used + j, gain + (k - required_[c] + j) * weight_);
+                }
+            }
+        }
+    }
+
+    bool record_steps_;
+    std::vector<Step> steps_;
+    std::vector<int16_t> next_value_;
+    std::vector<uint16_t> current_;
+    std::vector<int16_t> current_value_;
+    std::vector<uint16_t> next_;
+    int required_[TileCode::NUM_COLORS] = {};
+    int extra_[TileCode::NUM_COLORS] = {};
+    bool joker_ok_[TileCode::NUM_COLORS] = {};
+    int number_ = 0;
+    int weight_ = 1;
+    int jokers_ = 0;
+    int required_jokers_ = 0;
+    int from_ = 0;
+    int from_value_ = 0;
+    int best_value_ = -1;
+};
+
+// Can every tile in the pool be placed into valid runs and groups? Also false if `budget`
+// runs out first.
+inline bool is_arrangeable(const PoolCounts& counts, Budget* budget = nullptr) {
+    TRACE_FUNCTION();
+    return Sweep::local(false).run(counts, nullptr, Objective::TILES, budget) >= 0;
+}
+
+inline bool is_arrangeable(const std::vector<Tile>& tiles) {
+    std::optional<PoolCounts> counts = to_counts(tiles);
+    return counts && is_arrangeable(*counts);
+}
+
+// Single-pass "play as much as possible": every `required` tile stays placed and as many
+// `optional` tiles as possible join them (by count, or by points for an initial meld).
+// Returns how many optional tiles of each kind (and jokers) are placed, or std::nullopt if
+// the required tiles alone cannot be arranged (or `budget` ran out). `value`, if given,
+// receives the objective's value of the placed optional tiles.
+inline std::optional<PoolCounts> max_playable(const PoolCounts& required, const PoolCounts& optional,
+                                              Objective objective = Objective::TILES, int* value = nullptr,
+                                              Budget* budget = nullptr) {
+    TRACE_FUNCTION();
+    Sweep& sweep = Sweep::local(true);
+    int state = sweep.run(required, &optional, objective, budget);
+    if (state < 0) {
+        return std::nullopt;
+    }
+    if (value) {
+        *value = sweep.best_value();
+    }
+
+    PoolCounts played{};
+    played[JOKER_SLOT] = static_cast<uint8_t>(state_jokers(state) - required[JOKER_SLOT]);
+    for (int number = TileCode::NUM_NUMBERS; number >= 1; --number) {
+        const Step& step = sweep.step(number, state);
+        for (int c = 0, rest = step.used_code; c < TileCode::NUM_COLORS; ++c, rest /= 3) {
+            int kind = TileCode::kindOf(number, c + 1);
+            played[kind] = static_cast<uint8_t>(rest % 3 - required[kind]);
+        }
+        state = step.previous_state;
+    }
+    return played;
+}
+
+// Hands out the physical copies of each kind in ascending code order, and a joker once a
+// kind's real copies are used up. Its lists live in `memory` (an arena scope).
+class TileSupply {
+public:
+    template <typename Tiles>
+    TileSupply(const Tiles& tiles, std::pmr::memory_resource* memory) : by_kind_(JOKER_SLOT + 1, memory) {
+        std::pmr::vector<Tile> sorted_tiles(tiles.begin(), tiles.end(), memory);
+        std::sort(sorted_tiles.begin(), sorted_tiles.end());
+        for (const auto& tile : sorted_tiles) {
+            by_kind_[count_slot(tile)].push_back(tile);
+        }
+        next_.fill(0);
+    }
+
+    Tile take(int number, int c) {
+        int kind = TileCode::kindOf(number, c);
+        if (next_[kind] == by_kind_[kind].size()) {
+            kind = JOKER_SLOT;
+        }
+        return by_kind_[kind][next_[kind]++];
+    }
+
+private:
+    std::pmr::vector<std::pmr::vector<Tile>> by_kind_;
+    std::array<uint8_t, JOKER_SLOT + 1> next_;
+};
+
+// Replays a path of DP states with explicit slots to recover the actual sets, which are
+// appended to `sets`. The scratch lists live in `memory`, so the only heap memory is
+// whatever `sets` has to grow by.
+class Replay {
+public:
+    template <typename Tiles>
+    Replay(const Tiles& tiles, std::vector<GameSet>& sets, std::pmr::memory_resource* memory)
+        : supply_(tiles, memory), slots_(TileCode::NUM_COLORS * 2, memory), sets_(sets), memory_(memory) {}
+
+    void step(int number, int to_state, int leftover_code) {
+        for (int c = 0; c < TileCode::NUM_COLORS; ++c) {
+            advance_color(number, c, SLOT_PAIRS[state_pair(to_state, c)]);
+        }
+        place_groups(number, leftover_code);
+    }
+
+    void finish() {
+        for (auto& slot : slots_) {
+            close(slot);
+        }
+    }
+
+private:
+    static bool legal(size_t length, int next) {
+        switch (next) {
+        case 0: return length == 0 || length >= RUN_CAP;
+        case 1: return length == 0;
+        case 2: return length == 1;
+        default: return length >= 2;
+        }
+    }
+
+    void close(std::pmr::vector<Tile>& slot) {
+        if (slot.size() >= RUN_CAP) {
+            sets_.push_back(GameSet(slot.begin(), slot.end(), SetType::RUN));
+        }
+        slot.clear();
+    }
+
+    void advance_color(int number, int c, SlotPair target) {
+        std::pmr::vector<Tile>* slot = &slots_[c * 2];
+        int order[2][2] = {{target.low, target.high}, {target.high, target.low}};
+        for (const auto& next : order) {
+            if (legal(slot[0].size(), next[0]) && legal(slot[1].size(), next[1])) {
+                for (int s = 0; s < 2; ++s) {
+                    if (next[s] == 0) {
+                        close(slot[s]);
+                    } else {
+                        slot[s].push_back(supply_.take(number, c + 1));
+                    }
+                }
+                return;
+            }
+        }
+    }
+
+    void place_groups(int number, int leftover_code) {
+        if (leftover_code == 0) {
+            return;
+        }
+        std::pmr::vector<Tile> first(memory_), second(memory_);
+        int singles_placed = 0;
+        for (int c = 0, rest = leftover_code; c < TileCode::NUM_COLORS; ++c, rest /= 3) {
+            int left = rest % 3;
+            if (left == 2) {
+                first.push_back(supply_.take(number, c + 1));
+                second.push_back(supply_.take(number, c + 1));
+            } else if (left == 1) {
+                (singles_placed++ % 2 == 0 ? first : second).push_back(supply_.take(number, c + 1));
+            }
+        }
+        if (second.size() < RUN_CAP) {
+            first.insert(first.end(), second.begin(), second.end());
+            second.clear();
+        }
+        sets_.push_back(GameSet(first.begin(), first.end(), SetType::GROUP));
+        if (!second.empty()) {
+            sets_.push_back(GameSet(second.begin(), second.end(), SetType::GROUP));
+        }
+    }
+
+    TileSupply supply_;
+    std::pmr::vector<std::pmr::vector<Tile>> slots_; // Two run slots per color.
+    std::vector<GameSet>& sets_;
+    std::pmr::memory_resource* memory_;
+};
+
+// Full answer from a single DP sweep: an arrangement of every tile in `tiles`, written
+// over `sets`, or false if none exists (or `budget` runs out; `sets` is then left empty).
+// Runs come out as long as possible. `sets` keeps its capacity, so a caller that reuses
+// it across calls stops allocating once it is large enough.
+template <typename Tiles = std::vector<Tile>>
+inline bool solve_into(const Tiles& tiles, std::vector<GameSet>& sets, Budget* budget = nullptr) {
+    TRACE_FUNCTION();
+    sets.clear();
+    std::optional<PoolCounts> counts = to_counts(tiles);
+    if (!counts) {
+        return false;
+    }
+    Sweep& sweep = Sweep::local(true);
+    int final_state = sweep.run(*counts, nullptr, Objective::TILES, budget);
+    if (final_state < 0) {
+        return false;
+    }
+
+    int path[TileCode::NUM_NUMBERS + 1];
+    int leftovers[TileCode::NUM_NUMBERS + 1];
+    path[TileCode::NUM_NUMBERS] = final_state;
+    for (int number = TileCode::NUM_NUMBERS; number >= 1; --number) {
+        const Step& step = sweep.step(number, path[number]);
+        path[number - 1] = step.previous_state;
+        leftovers[number] = step.leftover_code;
+    }
+
+    Arena::Scope scratch;
+    Replay replay(tiles, sets, scratch.resource());
+    for (int number = 1; number <= TileCode::NUM_NUMBERS; ++number) {
+        replay.step(number, path[number], leftovers[number]);
+    }
+    replay.finish();
+    return true;
+}
+
+// solve_into returning a fresh vector: the arrangement, or std::nullopt if there is none.
+template <typename Tiles = std::vector<Tile>>
+inline std::optional<std::vector<GameSet>> solve(const Tiles& tiles, Budget* budget = nullptr) {
+    std::vector<GameSet> sets;
+    if (!solve_into(tiles, sets, budget)) {
+        return std::nullopt;
+    }
+    return sets;
+}
+
+// Pools below this size are probed serially: a probe then costs about as much as handing
+// it to another thread.
+constexpr size_t PARALLEL_MIN_TILES = 24;
+
+constexpr size_t max_sets_per_kind() {
+    size_t most = 0;
+    for (int kind = 0; kind < TileCode::NUM_KINDS; ++kind) {
+        size_t sets = SetFinder::KIND_INDEX.offsets[kind + 1] - SetFinder::KIND_INDEX.offsets[kind];
+        most = sets > most ? sets : most;
+    }
+    return most;
+}
+
+constexpr size_t MAX_SETS_PER_KIND = max_sets_per_kind();
+
+inline void remove_set(PoolCounts& pool, const SetFinder::CatalogEntry& entry) {
+    for (TileCode::KindMask rest = entry.mask; rest != 0; rest &= rest - 1) {
+        --pool[__builtin_ctzll(rest)];
+    }
+}
+
+inline void restore_set(PoolCounts& pool, const SetFinder::CatalogEntry& entry) {
+    for (TileCode::KindMask rest = entry.mask; rest != 0; rest &= rest - 1) {
+        ++pool[__builtin_ctzll(rest)];
+    }
+}
+
+// Index of the first candidate set whose removal leaves `pool` arrangeable, or
+// candidates.size() if there is none (or `budget` ran out).
+template <typename Candidates>
+inline size_t first_arrangeable(PoolCounts& pool, const Candidates& candidates, Budget* budget) {
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        const SetFinder::CatalogEntry& entry = SetFinder::CATALOG[candidates[i]];
+        remove_set(pool, entry);
+        bool arrangeable = is_arrangeable(pool, budget);
+        restore_set(pool, entry);
+        if (arrangeable) {
+            return i;
+        }
+    }
+    return candidates.size();
+}
+
+// first_arrangeable with the candidates probed concurrently on `threads`. Runners take the
+// candidates in order; once candidate i succeeds, candidates after it are skipped and the
+// probes already running on them are cancelled through their Budget. The lowest success
+// wins, so the answer is the serial one.
+template <typename Candidates>
+inline size_t first_arrangeable_parallel(const PoolCounts& pool, const Candidates& candidates, ThreadPool& threads) {
+    std::array<std::atomic<bool>, MAX_SETS_PER_KIND> superseded{};
+    std::atomic<size_t> winner{candidates.size()};
+    threads.parallel_for(candidates.size(), 1, [&](size_t i) {
+        if (i > winner.load(std::memory_order_acquire)) {
+            return;
+        }
+        PoolCounts rest = pool;
+        remove_set(rest, SetFinder::CATALOG[candidates[i]]);
+        Budget budget(0, std::nullopt, &superseded[i]);
+        if (!is_arrangeable(rest, &budget)) {
+            return;
+        }
+        size_t current = winner.load(std::memory_order_acquire);
+        while (i < current && !winner.compare_exchange_weak(current, i, std::memory_order_acq_rel)) {
+        }
+        for (size_t later = i + 1; later < candidates.size(); ++later) {
+            superseded[later].store(true, std::memory_order_relaxed);
+        }
+    });
+    return winner.load(std::memory_order_acquire);
+}
+
+// The arrangement the reference backtracker (BoardManipulation::find_valid_arrangement_recursive)
+// would return: repeatedly take the first catalog set through the lowest remaining tile, in
+// GameSet order, whose removal leaves an arrangeable pool. The DP answers each of those
+// questions, so there is no backtracking.
+// The catalog holds no jokers, so a pool with jokers gets solve()'s arrangement instead.
+// `budget` covers every probe. With `threads` (and no budget, which belongs to one thread)
+// the probes of each step run concurrently, for pools of PARALLEL_MIN_TILES or more; the
+// result is the same.
+template <typename Tiles = std::vector<Tile>>
+inline std::optional<std::vector<GameSet>> solve_canonical(const Tiles& tiles, Budget* budget = nullptr,
+                                                           ThreadPool* threads = nullptr) {
+    TRACE_FUNCTION();
+    std::optional<PoolCounts> counts = to_counts(tiles);
+    if (!counts || !is_arrangeable(*counts, budget)) {
+        return std::nullopt;
+    }
+    if ((*counts)[JOKER_SLOT] > 0) {
+        return solve(tiles, budget); // The catalog order is defined over real tiles only.
+    }
+
+    Arena::Scope scratch;
+    TileSupply supply(tiles, scratch.resource());
+    PoolCounts& pool = *counts;
+    size_t remaining = tiles.size();
+    std::vector<GameSet> arrangement;
+    std::pmr::vector<Tile> set_tiles(scratch.resource());
+    set_tiles.reserve(TileCode::NUM_NUMBERS);
+    std::pmr::vector<uint16_t> candidates(scratch.resource());
+    candidates.reserve(MAX_SETS_PER_KIND);
+
+    while (remaining > 0) {
+        int lowest_kind = 0;
+        TileCode::KindMask pool_kinds = 0;
+        for (int kind = TileCode::NUM_KINDS - 1; kind >= 0; --kind) {
+            if (pool[kind] > 0) {
+                lowest_kind = kind;
+                pool_kinds |= TileCode::kindBit(kind);
+            }
+        }
+        candidates.clear();
+        for (uint16_t index : SetFinder::sets_containing(lowest_kind)) {
+            if (SetFinder::can_form(SetFinder::CATALOG[index], pool_kinds)) {
+                candidates.push_back(index);
+            }
+        }
+        size_t chosen = threads && !budget && candidates.size() > 1 && remaining >= PARALLEL_MIN_TILES
+            ? first_arrangeable_parallel(pool, candidates, *threads)
+            : first_arrangeable(pool, candidates, budget);
+        if (chosen == candidates.size()) {
+            return std::nullopt; // Out of budget; otherwise unreachable while the DP and the catalog agree.
+        }
+
+        const SetFinder::CatalogEntry& entry = SetFinder::CATALOG[candidates[chosen]];
+        remove_set(pool, entry);
+        set_tiles.clear();
+        for (TileCode::KindMask rest = entry.mask; rest != 0; rest &= rest - 1) {
+            int kind = __builtin_ctzll(rest);
+            set_tiles.push_back(supply.take(TileCode::kindNumber(kind), TileCode::kindColor(kind)));
+        }
+        arrangement.push_back(GameSet(set_tiles.begin(), set_tiles.end(), entry.type));
+        remaining -= entry.size;
+    }
+    return arrangement;
+}
+
+} // namespace ArrangementSolver
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <random>    // For std::mt19937_64
+#include <algorithm> // For std::sort, std::shuffle
+#include <iostream>
+#include <iomanip>
+
+#include "Tile.hpp"
+#include "Board.hpp"      // For BoardState, GameSet
+#include "SetFinder.hpp"  // For the catalog that random boards are drawn from
+#include "PerformanceTracer.hpp" // For the per-thread allocation totals
+#include "Arena.hpp"         // For the search arena's peak usage
+
+// Microbenchmark harness for the bench binary.
+//
+// measure() runs an operation in timed samples of `batch` calls each. The batch is sized
+// so a sample lasts about SAMPLE_NANOSECONDS, which keeps clock overhead out of fast
+// operations; samples continue until the case has run for min_seconds. Latency
+// percentiles are over per-call sample averages, so for a fast operation they describe
+// batches, not single calls.
+//
+// Allocations are the calling thread's PerformanceTracer::thread_allocations, which only
+// move in a binary that includes AllocationHook.hpp; elsewhere they read zero. Only the
+// timed batches are counted, not the harness's own bookkeeping between them. Memory the
+// operation takes from the thread's Arena is not an allocation; its high-water mark over
+// the timed batches is reported as arena_peak_bytes instead.
+//
+// Results are printed as one tab-separated line per case, after a header line, so that
+// runs from two commits can be joined on (benchmark, params) and compared.
+namespace Benchmark {
+
+constexpr double SAMPLE_NANOSECONDS = 20000;
+
+// Keeps the compiler from discarding a result that is never read.
+template <typename T>
+inline void keep(const T& value) {
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+struct Result {
+    std::string name;
+    std::string params;
+    uint64_t operations = 0;
+    double ns_per_op = 0;
+    double ops_per_second = 0;
+    double allocations_per_op = 0;
+    size_t arena_peak_bytes = 0;
+    double p50_ns = 0;
+    double p90_ns = 0;
+    double p99_ns = 0;
+    double max_ns = 0;
+};
+
+inline double percentile(const std::vector<double>& sorted_samples, double fraction) {
+    if (sorted_samples.empty()) {
+        return 0;
+    }
+    size_t index = static_cast<size_t>(fraction * (sorted_samples.size() - 1) + 0.5);
+    return sorted_samples[std::min(index, sorted_samples.size() - 1)];
+}
+
+// Times op(i) for i = 0, 1, 2, ...; op should cycle through its inputs with i.
+template <typename Op>
+Result measure(const std::string& name, const std::string& params, double min_seconds, Op op) {
+    using Clock = std::chrono::steady_clock;
+    Result result;
+    result.name = name;
+    result.params = params;
+
+    // Warm up caches and thread-local buffers, and size the batch from the warm-up time.
+    uint64_t index = 0;
+    uint64_t batch = 1;
+    while (true) {
+        auto start = Clock::now();
+        for (uint64_t k = 0; k < batch; ++k) {
+            op(index++);
+        }
+        double elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        if (elapsed >= SAMPLE_NANOSECONDS || batch >= (uint64_t(1) << 24)) {
+            batch = std::max<uint64_t>(1, static_cast<uint64_t>(batch * SAMPLE_NANOSECONDS / std::max(elapsed, 1.0)));
+            break;
+        }
+        batch *= 2;
+    }
+
+    std::vector<double> samples;
+    double total_ns = 0;
+    uint64_t allocations = 0;
+    Arena::local().reset_peak();
+    while (total_ns < min_seconds * 1e9 || samples.size() < 10) {
+        uint64_t allocations_before = PerformanceTracer::thread_allocations.count;
+        auto start = Clock::now();
+        for (uint64_t k = 0; k < batch; ++k) {
+            op(index++);
+        }
+        double elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        allocations += PerformanceTracer::thread_allocations.count - allocations_before;
+        samples.push_back(elapsed / batch);
+        total_ns += elapsed;
+        result.operations += batch;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    result.ns_per_op = total_ns / result.operations;
+    result.ops_per_second = total_ns > 0 ? result.operations * 1e9 / total_ns : 0;
+    result.allocations_per_op = static_cast<double>(allocations) / result.operations;
+    result.arena_peak_bytes = Arena::local().peak_bytes();
+    result.p50_ns = percentile(samples, 0.50);
+    result.p90_ns = percentile(samples, 0.90);
+    result.p99_ns = percentile(samples, 0.99);
+    result.max_ns = samples.back();
+    return result;
+}
+
+inline void print_header(std::ostream& out) {
+    out << "benchmark\tparams\toperations\tns_per_op\tops_per_s\tallocs_per_op\tarena_peak_bytes\tp50_ns\tp90_ns\tp99_ns\tmax_ns\n";
+}
+
+inline void print_result(std::ostream& out, const Result& result) {
+    out << result.name << '\t' << result.params << '\t' << result.operations << '\t'
+        << std::fixed << std::setprecision(1) << result.ns_per_op << '\t'
+        << std::setprecision(0) << result.ops_per_second << '\t'
+        << std::setprecision(2) << result.allocations_per_op << '\t'
+        << result.arena_peak_bytes << '\t'
+        << std::setprecision(1) << result.p50_ns << '\t' << result.p90_ns << '\t'
+        << result.p99_ns << '\t' << result.max_ns << '\n';
+    out.flush();
+}
+
+struct Position {
+    BoardState board;
+    std::vector<Tile> hand;
+};
+
+// A random valid board of (close to) board_tiles tiles plus a hand of hand_size tiles
+// drawn from what is left of the 104 numbered tiles (fewer if not enough are left). Sets
+// are catalog sets taken in random order while both copies last, so the board is valid
+// by construction.
+inline Position random_position(int board_tiles, int hand_size, std::mt19937_64& rng) {
+    std::array<int, TileCode::NUM_KINDS> used{};
+    std::vector<int> order(SetFinder::CATALOG_SIZE);
+    for (int i = 0; i < SetFinder::CATALOG_SIZE; ++i) {
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), rng);
+
+    Position position;
+    std::vector<GameSet> sets;
+    int placed = 0;
+    for (int index : order) {
+        const SetFinder::CatalogEntry& entry = SetFinder::CATALOG[index];
+        if (placed + entry.size > board_tiles) {
+            continue;
+        }
+        bool available = true;
+        for (TileCode::KindMask rest = entry.mask; rest != 0; rest &= rest - 1) {
+            available = available && used[__builtin_ctzll(rest)] < 2;
+        }
+        if (!available) {
+            continue;
+        }
+        std::vector<Tile> tiles;
+        for (TileCode::KindMask rest = entry.mask; rest != 0; rest &= rest - 1) {
+            int kind = __builtin_ctzll(rest);
+            tiles.push_back(Tile::fromCode(static_cast<uint8_t>(kind * 2 + used[kind]++)));
+        }
+        sets.push_back(GameSet(tiles, entry.type));
+        placed += entry.size;
+    }
+    position.board = BoardState(sets);
+
+    std::vector<Tile> rest;
+    for (int kind = 0; kind < TileCode::NUM_KINDS; ++kind) {
+        for (int copy = used[kind]; copy < 2; ++copy) {
+            rest.push_back(Tile::fromCode(static_cast<uint8_t>(kind * 2 + copy)));
+        }
+    }
+    std::shuffle(rest.begin(), rest.end(), rng);
+    position.hand.assign(rest.begin(), rest.begin() + std::min<size_t>(hand_size, rest.size()));
+    std::sort(position.hand.begin(), position.hand.end());
+    return position;
+}
+
+} // namespace Benchmark
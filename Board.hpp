@@ -1,30 +1,172 @@
 #pragma once
 
 #include <vector>
+#include <array>   // For the per-tile placement counts
+#include <utility> // For std::move
 #include <numeric> // For std::accumulate if needed for printing or IDs
 #include <algorithm> // For std::all_of, std::sort, etc.
 #include <optional>  // For std::optional
+#include <memory_resource> // For the arena-backed search containers
+#include <type_traits> // For std::is_trivially_copyable_v
 // Tile.hpp, runs.hpp, groups.hpp are now included via GameTypes.hpp
 #include "GameTypes.hpp" // Defines GameSet, SetType
 #include "utilities.hpp" // For sorting tiles if necessary within sets, and other board utilities
 #include "SetFinder.hpp" // For find_all_possible_sets
+#include "ArrangementSolver.hpp" // DP arrangement solver used by can_add_tiles_to_board
+#include "TranspositionTable.hpp" // Memo of infeasible sub-pools for the backtracking search
 #include "PerformanceTracer.hpp" // For performance tracing
+#include "Zobrist.hpp" // For incremental board hashes
+#include "Arena.hpp" // Scratch memory released when a search returns
 
 // class Tile; // Forward declaration no longer needed if GameTypes pulls it.
 // GameTypes.hpp already includes <optional> but being explicit here is fine.
 
+// The sets of a board, stored inline, so a BoardState needs no heap memory and copies as
+// plain bytes. A valid board places each physical tile at most once, in sets of three or
+// more, so it never has more than CAPACITY sets. Sets added past CAPACITY are dropped and
+// the collection remembers that it overflowed, which makes its board invalid.
+class BoardSets {
+public:
+    static constexpr size_t CAPACITY = (TileCode::NUM_KINDS * 2 + TileCode::NUM_JOKERS) / 3;
+
+    using value_type = GameSet;
+    using iterator = GameSet*;
+    using const_iterator = const GameSet*;
+
+    BoardSets() = default;
+
+    template <typename Iterator>
+    BoardSets(Iterator first, Iterator last) {
+        assign(first, last);
+    }
+
+    template <typename Iterator>
+    void assign(Iterator first, Iterator last) {
+        clear();
+        for (; first != last; ++first) {
+            push_back(*first);
+        }
+    }
+
+    // False, with the set dropped, if the collection is full.
+    bool push_back(const GameSet& set) {
+        if (size_ == CAPACITY) {
+            overflowed_ = true;
+            return false;
+        }
+        items_[size_++] = set;
+        return true;
+    }
+
+    // Removes the set at `position`; the others keep their order.
+    iterator erase(iterator position) {
+        std::copy(position + 1, end(), position);
+        --size_;
+        return position;
+    }
+
+    void clear() {
+        size_ = 0;
+        overflowed_ = false;
+    }
+
+    iterator begin() { return items_.data(); }
+    iterator end() { return items_.data() + size_; }
+    const_iterator begin() const { return items_.data(); }
+    const_iterator end() const { return items_.data() + size_; }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    bool overflowed() const { return overflowed_; }
+    GameSet& operator[](size_t i) { return items_[i]; }
+    const GameSet& operator[](size_t i) const { return items_[i]; }
+    const GameSet& front() const { return items_[0]; }
+    const GameSet& back() const { return items_[size_ - 1]; }
+
+    // For code that still takes a std::vector<GameSet>.
+    operator std::vector<GameSet>() const {
+        return std::vector<GameSet>(begin(), end());
+    }
+
+    bool operator==(const BoardSets& other) const {
+        return overflowed_ == other.overflowed_ && std::equal(begin(), end(), other.begin(), other.end());
+    }
 
+    bool operator!=(const BoardSets& other) const {
+        return !(*this == other);
+    }
+
+private:
+    std::array<GameSet, CAPACITY> items_{};
+    uint8_t size_ = 0;
+    bool overflowed_ = false;
+};
+
+// A board keeps its hashes and its validity up to date as sets are added, replaced and
+// removed: how many sets are invalid, and how many times each physical tile is placed.
+// isValidBoard() is then a constant-time query, and an edit costs only the sets it
+// touches. After editing `sets` directly, call rehash() to rebuild all of it.
 class BoardState {
 public:
-    std::vector<GameSet> sets; // GameSet is now from GameTypes.hpp
+    BoardSets sets;
 
     BoardState() = default;
 
-    BoardState(const std::vector<GameSet>& initial_sets) : sets(initial_sets) {}
+    BoardState(const std::vector<GameSet>& initial_sets) : sets(initial_sets.begin(), initial_sets.end()) {
+        rehash();
+    }
 
     void addSet(const GameSet& set) {
-        if (set.isValid()) { // Optionally only add valid sets, or let validation happen elsewhere
-            sets.push_back(set);
+        if (set.isValid() && sets.push_back(set)) { // Optionally only add valid sets, or let validation happen elsewhere
+            track(set);
+        }
+    }
+
+    // Puts `set` in place of sets[index], which must exist. Unlike addSet, an invalid set is
+    // kept (and makes the board invalid), so an edit in progress can be represented.
+    void replaceSet(size_t index, const GameSet& set) {
+        untrack(sets[index]);
+        sets[index] = set;
+        track(set);
+    }
+
+    // Removes sets[index], which must exist; the other sets keep their order.
+    void removeSet(size_t index) {
+        untrack(sets[index]);
+        sets.erase(sets.begin() + index);
+    }
+
+    // Replaces every set on the board with `replacement`'s, copied into the inline storage.
+    void assignSets(const std::vector<GameSet>& replacement) {
+        sets.assign(replacement.begin(), replacement.end());
+        rehash();
+    }
+
+    // Whether this physical tile is in one of the sets.
+    bool holds(const Tile& tile) const {
+        return placed_[tile.getCode()] > 0;
+    }
+
+    // Zobrist hash of the tile kinds on the board, independent of how they are grouped.
+    uint64_t tileHash() const {
+        return tile_hash_.value();
+    }
+
+    // Hash of the set structure: the sum of per-set hashes, so set order does not matter.
+    uint64_t structureHash() const {
+        return structure_hash_;
+    }
+
+    // Recomputes the hashes and the validity counts; only needed after editing `sets`
+    // directly.
+    void rehash() {
+        tile_hash_ = Zobrist::PoolHash();
+        structure_hash_ = 0;
+        invalid_sets_ = 0;
+        repeated_tiles_ = 0;
+        placed_.fill(0);
+        for (const auto& set : sets) {
+            track(set);
         }
     }
 
@@ -54,7 +196,7 @@ public:
 
     // Equality operator for comparing BoardStates - useful for testing
     bool operator==(const BoardState& other) const {
-        if (sets.size() != other.sets.size()) {
+        if (sets.size() != other.sets.size() || structure_hash_ != other.structure_hash_) {
             return false;
         }
         // This requires GameSet to have a reliable operator==
@@ -64,139 +206,172 @@ public:
         // A more robust comparison would involve sorting copies of the sets vectors
         // or checking for set equivalence regardless of order.
         // For simplicity now:
-        return sets == other.sets; // Relies on GameSet::operator== and vector::operator==
+        return sets == other.sets; // Relies on GameSet::operator==
     }
 
     // Checks if all sets on the board are valid and all tiles are unique across sets.
     bool isValidBoard() const {
-        TRACE_FUNCTION();
-        if (sets.empty()) {
-            return true; // An empty board is considered valid.
-        }
-
-        std::set<Tile> tiles_on_board_check; // To check for uniqueness of tiles. Requires Tile::operator<
-        size_t total_tiles_in_all_sets = 0;
+        return invalid_sets_ == 0 && repeated_tiles_ == 0 && !sets.overflowed();
+    }
 
-        for (const auto& game_set : sets) {
-            if (!game_set.isValid()) {
-                // Optional: Debug print for which set is invalid
-                // std::cout << "Debug isValidBoard: Invalid set detected: "; game_set.print();
-                return false;
-            }
-            total_tiles_in_all_sets += game_set.tiles.size();
-            for (const auto& tile : game_set.tiles) {
-                tiles_on_board_check.insert(tile);
-            }
+private:
+    void track(const GameSet& set) {
+        for (const auto& tile : set.tiles) {
+            tile_hash_.add(tile);
+            repeated_tiles_ += placed_[tile.getCode()]++ > 0;
         }
+        structure_hash_ += Zobrist::hash_set(set);
+        invalid_sets_ += !set.isValid();
+    }
 
-        // If the number of unique tiles inserted into the set is not equal to the
-        // total number of tiles counted across all sets, it means a tile was duplicated
-        // (used in more than one set).
-        if (tiles_on_board_check.size() != total_tiles_in_all_sets) {
-             // Optional: Debug print for tile duplication
-             // std::cout << "Debug isValidBoard: Tile duplication across sets. Unique: "
-             //           << tiles_on_board_check.size() << ", Total in sets: " << total_tiles_in_all_sets << std::endl;
-            return false;
+    void untrack(const GameSet& set) {
+        for (const auto& tile : set.tiles) {
+            tile_hash_.remove(tile);
+            repeated_tiles_ -= --placed_[tile.getCode()] > 0;
         }
-
-        return true;
+        structure_hash_ -= Zobrist::hash_set(set);
+        invalid_sets_ -= !set.isValid();
     }
+
+    Zobrist::PoolHash tile_hash_;
+    uint64_t structure_hash_ = 0;
+    std::array<uint8_t, TileCode::NUM_CODES> placed_{}; // Placements of each physical tile.
+    uint32_t invalid_sets_ = 0;
+    uint32_t repeated_tiles_ = 0; // Placements beyond the first, over all tiles.
 }; // End of BoardState class definition
 
+static_assert(std::is_trivially_copyable_v<BoardState>, "BoardState must copy as plain bytes");
+
 // Function to check if a collection of sets represents a valid board state.
 // This is useful for validating potential new board configurations before committing them.
-inline bool is_board_valid(const std::vector<GameSet>& board_sets) {
+// Valid means every set is valid and no physical tile appears in two sets. Each set is
+// encoded once; both checks are then mask tests (see SetValidator).
+// Sets is std::vector<GameSet> or a board's BoardSets.
+template <typename Sets = std::vector<GameSet>>
+inline bool is_board_valid(const Sets& board_sets) {
     TRACE_FUNCTION();
-    if (board_sets.empty()) {
-        return true; // An empty collection of sets is valid.
+    SetValidator::TileUse seen;
+    bool valid = true;
+    for (const auto& game_set : board_sets) {
+        SetValidator::SetCode code = SetValidator::encode(game_set.tiles, game_set.type);
+        valid &= SetValidator::is_valid(code) & seen.add(code);
     }
-    // Use a temporary BoardState to leverage its isValidBoard logic.
-    BoardState temp_board_state(board_sets);
-    return temp_board_state.isValidBoard();
+    return valid; // An empty collection of sets is valid.
 }
 
 // Helper namespace for can_add_tiles_to_board logic
 namespace BoardManipulation {
 
-// Recursive helper function for can_add_tiles_to_board
-// Returns true if a valid arrangement is found, false otherwise.
-// result_sets will contain the valid arrangement if true is returned.
-bool find_valid_arrangement_recursive(
-    std::vector<Tile>& current_pool_tiles, // Tiles remaining to be placed
-    const std::vector<GameSet>& all_possible_valid_sets, // All valid sets that can be formed from the initial combined pool
-    std::vector<GameSet>& current_arrangement, // The sets formed so far in this path
-    const std::set<Tile>& original_tiles_to_add_set, // For checking if all *added* tiles are used
-    std::set<Tile>& used_tiles_from_add_pool, // Tracks which of original_tiles_to_add_set are in current_arrangement
-    size_t total_tiles_to_place // The total number of tiles in the initial combined pool
-) {
-    TRACE_FUNCTION();
-    // Base Case 1: All tiles from the initial combined pool have been placed into sets
-    if (current_pool_tiles.empty()) {
-        // Check if all *specific* tiles from tiles_to_add were used
-        bool all_added_tiles_used = true;
-        if (used_tiles_from_add_pool.size() != original_tiles_to_add_set.size()) {
-            all_added_tiles_used = false;
+// Remaining pool of the reference search: a count (0-2) per tile kind, the mask of kinds
+// present, the pool's Zobrist hash and its size. A catalog set holds each kind at most
+// once, so its count vector is its kind mask: "can the set be formed" is one 64-lane mask
+// test against the kinds present, and placing or restoring a set adjusts its kinds' counts
+// in place. The state lives on the stack; a search node touches no heap.
+class SearchPool {
+public:
+    // Fails (returns false) for tiles no catalog set can hold: jokers and the spare row.
+    template <typename Tiles>
+    bool assign(const Tiles& tiles) {
+        for (const auto& tile : tiles) {
+            int kind = tile.getKind();
+            if (!TileCode::isPlayableKind(kind)) {
+                return false;
+            }
+            add_kind(kind);
         }
-        // Further check: ensure all tiles from original_tiles_to_add_set are indeed in used_tiles_from_add_pool
-        // This is implicitly covered if used_tiles_from_add_pool is built correctly.
+        return true;
+    }
 
-        return all_added_tiles_used; // If so, a valid arrangement is found
+    bool empty() const {
+        return tiles_ == 0;
     }
 
-    // Optimization: if current_arrangement already uses more tiles than available, prune
-    size_t tiles_in_current_arrangement = 0;
-    for(const auto& s : current_arrangement) {
-        tiles_in_current_arrangement += s.tiles.size();
+    size_t size() const {
+        return tiles_;
     }
-    if (tiles_in_current_arrangement > total_tiles_to_place) return false;
 
+    uint64_t hash() const {
+        return hash_;
+    }
 
-    // Iterate through all_possible_valid_sets that can be formed from the *initial* combined pool
-    for (const auto& candidate_set : all_possible_valid_sets) {
-        // Check if candidate_set can be formed from current_pool_tiles
-        std::vector<Tile> temp_pool = current_pool_tiles; // Work with a copy
-        bool can_form_set = true;
-        std::vector<Tile> tiles_for_this_set;
+    // The lowest kind left; the pool must not be empty.
+    int lowest_kind() const {
+        return __builtin_ctzll(present_);
+    }
 
-        for (const auto& tile_needed : candidate_set.tiles) {
-            auto it = std::find(temp_pool.begin(), temp_pool.end(), tile_needed);
-            if (it != temp_pool.end()) {
-                tiles_for_this_set.push_back(*it);
-                temp_pool.erase(it); // Remove tile so it can't be used again for this set
-            } else {
-                can_form_set = false;
-                break;
-            }
+    bool can_form(const SetFinder::CatalogEntry& entry) const {
+        return SetFinder::can_form(entry, present_);
+    }
+
+    void remove(const SetFinder::CatalogEntry& entry) {
+        for (TileCode::KindMask rest = entry.mask; rest != 0; rest &= rest - 1) {
+            int kind = __builtin_ctzll(rest);
+            hash_ ^= Zobrist::count_key(kind, counts_[kind]) ^ Zobrist::count_key(kind, counts_[kind] - 1);
+            present_ &= ~(TileCode::KindMask(--counts_[kind] == 0) << kind);
         }
+        tiles_ -= entry.size;
+    }
 
-        if (can_form_set) {
-            current_arrangement.push_back(candidate_set);
+    void restore(const SetFinder::CatalogEntry& entry) {
+        for (TileCode::KindMask rest = entry.mask; rest != 0; rest &= rest - 1) {
+            add_kind(__builtin_ctzll(rest));
+        }
+    }
 
-            // Update used_tiles_from_add_pool
-            std::set<Tile> newly_used_from_add_pool;
-            for(const auto& t : candidate_set.tiles){
-                if(original_tiles_to_add_set.count(t)){
-                    newly_used_from_add_pool.insert(t);
-                    used_tiles_from_add_pool.insert(t);
-                }
-            }
+private:
+    void add_kind(int kind) {
+        hash_ ^= Zobrist::count_key(kind, counts_[kind]) ^ Zobrist::count_key(kind, counts_[kind] + 1);
+        ++counts_[kind];
+        present_ |= TileCode::kindBit(kind);
+        ++tiles_;
+    }
 
-            // current_pool_tiles was already updated effectively by creating 'temp_pool'
-            // and then passing it to the recursive call.
-            // The actual current_pool_tiles for this level is 'temp_pool' after forming the set.
-            if (find_valid_arrangement_recursive(temp_pool, all_possible_valid_sets, current_arrangement, original_tiles_to_add_set, used_tiles_from_add_pool, total_tiles_to_place)) {
-                return true; // Solution found
-            }
+    std::array<uint8_t, TileCode::NUM_KINDS> counts_{};
+    TileCode::KindMask present_ = 0;
+    uint64_t hash_ = 0; // Same as pool_key of the remaining tiles.
+    size_t tiles_ = 0;
+};
 
-            // Backtrack
-            current_arrangement.pop_back();
-            for(const auto& t : newly_used_from_add_pool){ // Remove only those added in this step
-                used_tiles_from_add_pool.erase(t);
-            }
-            // current_pool_tiles is implicitly restored as temp_pool was a copy
+// Recursive helper function for can_add_tiles_to_board_reference
+// Returns true if every tile left in `pool` can be placed; chosen_sets then holds the
+// CATALOG indices of the sets, in the order they were placed. The caller assigns physical
+// tiles afterwards, each kind's copies in ascending order.
+// Every arrangement places the lowest remaining tile, so each level only branches on the
+// catalog sets through that tile's kind (SetFinder::sets_containing), in GameSet order.
+bool find_valid_arrangement_recursive(
+    SearchPool& pool, // Tiles remaining to be placed; restored before returning false
+    std::pmr::vector<uint16_t>& chosen_sets, // The sets formed so far in this path
+    TranspositionTable* table = nullptr // Optional memo of sub-pools known to be infeasible
+) {
+    TRACE_FUNCTION();
+    // Base Case: All tiles from the initial combined pool have been placed into sets
+    if (pool.empty()) {
+        return true;
+    }
+
+    // The remaining pool may already have failed via a different order of sets.
+    uint64_t key = pool.hash();
+    if (table && table->probe_infeasible(key)) {
+        return false;
+    }
+
+    for (uint16_t candidate : SetFinder::sets_containing(pool.lowest_kind())) {
+        const SetFinder::CatalogEntry& candidate_set = SetFinder::CATALOG[candidate];
+        if (!pool.can_form(candidate_set)) {
+            continue;
         }
+        pool.remove(candidate_set); // make
+        chosen_sets.push_back(candidate);
+        if (find_valid_arrangement_recursive(pool, chosen_sets, table)) {
+            return true; // Solution found
+        }
+        chosen_sets.pop_back(); // unmake
+        pool.restore(candidate_set);
     }
 
+    if (table) {
+        table->store_infeasible(key, pool.size());
+    }
     return false; // No solution found from this path
 }
 
@@ -204,16 +379,77 @@ bool find_valid_arrangement_recursive(
 // Main function to implement the logic for adding tiles to the board.
 // Returns an std::optional<BoardState>. Contains a new BoardState if tiles can be added successfully
 // and a valid board is formed, otherwise std::nullopt.
+// Feasibility comes from the DP in ArrangementSolver; the returned arrangement is the same one
+// can_add_tiles_to_board_reference finds, without its exponential backtracking. Callers that
+// only need some valid board (self-play) can pass canonical_layout = false to take the DP's own
+// arrangement, which skips the per-set feasibility probes. A `budget` bounds the solver's
+// work; running out of it also returns std::nullopt (see ArrangementSolver::Budget).
+// `threads` runs the canonical layout's probes concurrently (see solve_canonical).
 inline std::optional<BoardState> can_add_tiles_to_board(
     const BoardState& current_board_state,
-    const std::vector<Tile>& tiles_to_add
+    const std::vector<Tile>& tiles_to_add,
+    bool canonical_layout = true,
+    ArrangementSolver::Budget* budget = nullptr,
+    ThreadPool* threads = nullptr
 ) {
     TRACE_FUNCTION();
+    if (tiles_to_add.empty()) {
+        return std::nullopt; // Playing zero tiles is not a move.
+    }
+
+    Arena::Scope scratch;
+    std::pmr::vector<Tile> combined_pool(scratch.resource());
+    {
+        TRACE_SCOPE("combine pool");
+        size_t board_tiles = 0;
+        for (const auto& set : current_board_state.sets) {
+            board_tiles += set.tiles.size();
+        }
+        combined_pool.reserve(board_tiles + tiles_to_add.size());
+        for (const auto& set : current_board_state.sets) {
+            combined_pool.insert(combined_pool.end(), set.tiles.begin(), set.tiles.end());
+        }
+        combined_pool.insert(combined_pool.end(), tiles_to_add.begin(), tiles_to_add.end());
+    }
+
+    // Every tile of the pool is placed, so all of tiles_to_add are used. The board's validity
+    // still rejects arrangements that would hold the same physical tile twice.
+    std::optional<std::vector<GameSet>> arrangement = canonical_layout
+        ? ArrangementSolver::solve_canonical(combined_pool, budget, threads)
+        : ArrangementSolver::solve(combined_pool, budget);
+    if (!arrangement) {
+        return std::nullopt;
+    }
+    BoardState board(std::move(*arrangement));
+    if (!board.isValidBoard()) {
+        return std::nullopt;
+    }
+    return board;
+}
+
+// Reference implementation: exhaustive backtracking over the candidate sets.
+// Kept to cross-check the DP solver; not used on any hot path. The candidate sets come from
+// the joker-free catalog, so pools holding jokers are never arranged here.
+// `table` memoizes infeasible sub-pools; pass one to reuse it (and read its counters)
+// across calls, otherwise a default-sized table lives for this call only.
+inline std::optional<BoardState> can_add_tiles_to_board_reference(
+    const BoardState& current_board_state,
+    const std::vector<Tile>& tiles_to_add,
+    TranspositionTable* table = nullptr
+) {
+    TRACE_FUNCTION();
+    std::optional<TranspositionTable> local_table;
+    if (!table) {
+        table = &local_table.emplace();
+    }
     // Step 1: Combine tiles
-    std::vector<Tile> current_board_tiles = current_board_state.getAllTiles();
-    std::vector<Tile> combined_pool = current_board_tiles;
-    combined_pool.insert(combined_pool.end(), tiles_to_add.begin(), tiles_to_add.end());
-    std::sort(combined_pool.begin(), combined_pool.end()); // Important for consistency and SetFinder
+    std::vector<Tile> combined_pool;
+    {
+        TRACE_SCOPE("combine pool");
+        combined_pool = current_board_state.getAllTiles();
+        combined_pool.insert(combined_pool.end(), tiles_to_add.begin(), tiles_to_add.end());
+        std::sort(combined_pool.begin(), combined_pool.end()); // Important for consistency and SetFinder
+    }
 
     // Handle edge case: no tiles to add
     if (tiles_to_add.empty()) {
@@ -234,48 +470,51 @@ inline std::optional<BoardState> can_add_tiles_to_board(
     // This is managed by how Tile objects and their equality/comparison are handled.
     // Assuming combined_pool correctly reflects all unique physical tiles.
 
-    std::set<Tile> original_tiles_to_add_set(tiles_to_add.begin(), tiles_to_add.end());
-    if (original_tiles_to_add_set.empty() && !tiles_to_add.empty()){
-        // This implies tiles_to_add had duplicates that became one in the set, but this check might be redundant
-        // if tiles_to_add is always a list of unique tile instances.
+    // Step 2: Backtracking search; candidate sets come from SetFinder's index by tile kind.
+    Arena::Scope scratch;
+    SearchPool pool;
+    if (!pool.assign(combined_pool)) {
+        return std::nullopt; // The catalog holds no jokers or spare-row tiles.
     }
-
-
-    // Step 2: Find all possible valid sets from the combined pool
-    std::vector<GameSet> all_possible_valid_sets = SetFinder::find_all_possible_sets(combined_pool);
-
-    // Step 3: Backtracking search
-    std::vector<GameSet> result_sets;
-    std::set<Tile> used_tiles_from_add_pool; // Track usage of the specific tiles_to_add
-
-    std::vector<Tile> initial_pool_for_recursion = combined_pool; // Make a mutable copy for recursion
-
-    if (find_valid_arrangement_recursive(initial_pool_for_recursion, all_possible_valid_sets, result_sets, original_tiles_to_add_set, used_tiles_from_add_pool, combined_pool.size())) {
+    std::pmr::vector<uint16_t> chosen_sets(scratch.resource());
+    chosen_sets.reserve(combined_pool.size() / 3); // Every set holds at least three tiles.
+
+    if (find_valid_arrangement_recursive(pool, chosen_sets, table)) {
+        std::vector<GameSet> result_sets;
+        ArrangementSolver::TileSupply supply(combined_pool, scratch.resource());
+        std::pmr::vector<Tile> set_tiles(scratch.resource());
+        for (uint16_t index : chosen_sets) {
+            const SetFinder::CatalogEntry& entry = SetFinder::CATALOG[index];
+            set_tiles.clear();
+            for (TileCode::KindMask rest = entry.mask; rest != 0; rest &= rest - 1) {
+                int kind = __builtin_ctzll(rest);
+                set_tiles.push_back(supply.take(TileCode::kindNumber(kind), TileCode::kindColor(kind)));
+            }
+            result_sets.push_back(GameSet(set_tiles.begin(), set_tiles.end(), entry.type));
+        }
         // A valid arrangement forming a new board was found
         // Double check if the found arrangement is actually valid as a whole board
         // The recursion ensures all tiles are used and are in valid sets.
         // is_board_valid will check for uniqueness of tiles across sets in the proposed solution.
         if (is_board_valid(result_sets)) {
              // And ensure all tiles from tiles_to_add were indeed used
-            if (used_tiles_from_add_pool.size() == original_tiles_to_add_set.size()) {
-                 bool all_physically_added_tiles_present = true;
-                 std::multiset<Tile> final_tiles_in_sets;
-                 for(const auto& set : result_sets) {
-                     for(const auto& tile : set.tiles) {
-                         final_tiles_in_sets.insert(tile);
-                     }
+             bool all_physically_added_tiles_present = true;
+             std::multiset<Tile> final_tiles_in_sets;
+             for(const auto& set : result_sets) {
+                 for(const auto& tile : set.tiles) {
+                     final_tiles_in_sets.insert(tile);
                  }
-                 for(const auto& added_tile : tiles_to_add){ // Check original list, not the set
-                     if(final_tiles_in_sets.count(added_tile) == 0){
-                         all_physically_added_tiles_present = false;
-                         break;
-                     }
-                     final_tiles_in_sets.erase(final_tiles_in_sets.find(added_tile)); // remove one instance
+             }
+             for(const auto& added_tile : tiles_to_add){ // Check original list, not the set
+                 if(final_tiles_in_sets.count(added_tile) == 0){
+                     all_physically_added_tiles_present = false;
+                     break;
                  }
+                 final_tiles_in_sets.erase(final_tiles_in_sets.find(added_tile)); // remove one instance
+             }
 
-                if(all_physically_added_tiles_present) {
-                    return BoardState(result_sets); // Implicitly constructs std::optional<BoardState>
-                }
+            if(all_physically_added_tiles_present) {
+                return BoardState(result_sets); // Implicitly constructs std::optional<BoardState>
             }
         }
     }
@@ -0,0 +1,409 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <algorithm>       // For std::sort
+#include <memory_resource> // For the arena-backed matrix
+
+#include "GameTypes.hpp"         // For GameSet, Tile
+#include "SetFinder.hpp"         // For the set catalog the rows come from
+#include "ArrangementSolver.hpp" // For to_counts and TileSupply
+#include "PerformanceTracer.hpp" // For performance tracing
+#include "Arena.hpp"             // For search-scoped scratch memory
+
+// Dancing Links (Knuth's Algorithm X) over the set catalog.
+//
+// Arranging a pool is exact cover with multiplicities. Every tile kind in the pool is a
+// column that must be covered as many times as the pool holds it (once or twice). Every
+// catalog set formable from the pool's kinds is a row. Choosing a row lowers the need of
+// its columns. A column whose need reaches zero is covered the usual way: every row
+// through it is unlinked, the chosen one included. A row whose columns all still need a
+// tile stays linked, so the same set can be chosen twice.
+//
+// The search always branches on the most constrained uncovered column: the fewest rows
+// left beyond the covers it still needs (a column with no rows fails at once). It tries
+// the column's first row, then removes that row and tries the next, so every multiset of
+// sets is reached exactly once. A node is one call of the search.
+//
+// Near a full table almost every kind is doubled, and plain Algorithm X spends most of
+// its time in subtrees that cannot be covered. Once the remaining pool holds
+// LOOKAHEAD_TILES or more, each node first asks the ArrangementSolver DP whether the
+// rest can be arranged at all, and prunes the subtree if not. Small pools skip the
+// check, where branching is cheaper than a sweep.
+//
+// The catalog holds no jokers, so jokers are substituted before the matrix is built: each
+// joker is tried as every kind it could stand for, under the DP's rule that a kind totals
+// at most two, and every substitution the DP can arrange is searched as a joker-free pool.
+// Arrangements are multisets of catalog sets, listed in GameSet order. Physical copies are
+// handed out in ascending code order, as in ArrangementSolver, and a joker takes the place
+// of a kind's missing copy.
+namespace ExactCover {
+
+class Matrix {
+public:
+    // Remaining pools at least this large are checked with the DP before branching.
+    static constexpr int LOOKAHEAD_TILES = 24;
+
+    // The matrix for a pool given by its kind counts, allocated from `memory` (an arena
+    // scope). Jokers have no rows, so the pool must have had them substituted.
+    Matrix(const ArrangementSolver::PoolCounts& counts, std::pmr::memory_resource* memory)
+        : left_(memory), right_(memory), up_(memory), down_(memory), column_(memory),
+          row_(memory), need_(memory), size_(memory), row_start_(memory), row_entry_(memory),
+          chosen_(memory), removed_(memory), kind_(memory) {
+        if (counts[ArrangementSolver::JOKER_SLOT] > 0) {
+            return; // Not covered: the matrix stays empty and coverable_ false.
+        }
+        coverable_ = true;
+        remaining_ = counts;
+        for (int kind = 0; kind < TileCode::NUM_KINDS; ++kind) {
+            remaining_tiles_ += counts[kind];
+        }
+
+        // Sized exactly first: growing a vector in an arena leaves the old buffer behind.
+        TileCode::KindMask pool = 0;
+        int headers = 1; // The root comes first.
+        for (int kind = 0; kind < TileCode::NUM_KINDS; ++kind) {
+            if (counts[kind] > 0) {
+                pool |= TileCode::kindBit(kind);
+                ++headers;
+            }
+        }
+        size_t rows = 0;
+        size_t nodes = headers;
+        for (const auto& entry : SetFinder::CATALOG) {
+            if (SetFinder::can_form(entry, pool)) {
+                ++rows;
+                nodes += entry.size;
+            }
+        }
+        for (auto* links : {&up_, &down_, &column_, &row_}) {
+            links->reserve(nodes);
+        }
+        left_.reserve(headers);
+        right_.reserve(headers);
+        need_.reserve(headers);
+        size_.reserve(headers);
+        kind_.reserve(headers);
+        row_start_.reserve(rows + 1);
+        row_entry_.reserve(rows);
+        chosen_.reserve(nodes);
+        removed_.reserve(rows);
+
+        std::array<int, TileCode::NUM_KINDS> column_of;
+        column_of.fill(-1);
+        add_header(0);
+        for (int kind = 0; kind < TileCode::NUM_KINDS; ++kind) {
+            if (counts[kind] > 0) {
+                column_of[kind] = add_header(counts[kind]);
+                kind_.back() = static_cast<uint8_t>(kind);
+            }
+        }
+        right_.back() = 0;
+        left_[0] = headers - 1;
+
+        for (int index = 0; index < SetFinder::CATALOG_SIZE; ++index) {
+            const SetFinder::CatalogEntry& entry = SetFinder::CATALOG[index];
+            if (!SetFinder::can_form(entry, pool)) {
+                continue;
+            }
+            int row = static_cast<int>(row_entry_.size());
+            row_entry_.push_back(static_cast<uint16_t>(index));
+            row_start_.push_back(static_cast<int>(up_.size()));
+            for (TileCode::KindMask rest = entry.mask; rest != 0; rest &= rest - 1) {
+                int header = column_of[__builtin_ctzll(rest)];
+                int node = add_node(header, row);
+                up_[node] = up_[header];
+                down_[node] = header;
+                down_[up_[header]] = node;
+                up_[header] = node;
+                ++size_[header];
+            }
+        }
+        row_start_.push_back(static_cast<int>(up_.size()));
+    }
+
+    // Calls visit(rows) for each arrangement until it returns false; rows are CATALOG
+    // indices, in the order they were chosen. Returns false if visit asked to stop.
+    template <typename Visit>
+    bool search(Visit& visit) {
+        return !coverable_ || descend(visit);
+    }
+
+    uint64_t nodes() const {
+        return nodes_;
+    }
+
+private:
+    int add_node(int column, int row) {
+        int node = static_cast<int>(up_.size());
+        up_.push_back(node);
+        down_.push_back(node);
+        column_.push_back(column);
+        row_.push_back(row);
+        return node;
+    }
+
+    // Headers come before every row node, so a header's index is also its column index.
+    int add_header(uint8_t need) {
+        int header = add_node(static_cast<int>(up_.size()), -1);
+        left_.push_back(header - 1);
+        right_.push_back(header);
+        if (header > 0) {
+            right_[header - 1] = header;
+        }
+        need_.push_back(need);
+        size_.push_back(0);
+        kind_.push_back(0);
+        return header;
+    }
+
+    void unlink(int node) {
+        up_[down_[node]] = up_[node];
+        down_[up_[node]] = down_[node];
+        --size_[column_[node]];
+    }
+
+    void relink(int node) {
+        ++size_[column_[node]];
+        up_[down_[node]] = node;
+        down_[up_[node]] = node;
+    }
+
+    // Removes column c and every row through it from the other columns.
+    void cover(int c) {
+        right_[left_[c]] = right_[c];
+        left_[right_[c]] = left_[c];
+        for (int i = down_[c]; i != c; i = down_[i]) {
+            int row = row_[i];
+            for (int j = row_start_[row]; j < row_start_[row + 1]; ++j) {
+                if (j != i) {
+                    unlink(j);
+                }
+            }
+        }
+    }
+
+    void uncover(int c) {
+        for (int i = up_[c]; i != c; i = up_[i]) {
+            int row = row_[i];
+            for (int j = row_start_[row + 1] - 1; j >= row_start_[row]; --j) {
+                if (j != i) {
+                    relink(j);
+                }
+            }
+        }
+        right_[left_[c]] = c;
+        left_[right_[c]] = c;
+    }
+
+    void choose(int row) {
+        for (int j = row_start_[row]; j < row_start_[row + 1]; ++j) {
+            --remaining_[kind_[column_[j]]];
+            --remaining_tiles_;
+            if (--need_[column_[j]] == 0) {
+                cover(column_[j]);
+            }
+        }
+    }
+
+    void unchoose(int row) {
+        for (int j = row_start_[row + 1] - 1; j >= row_start_[row]; --j) {
+            if (need_[column_[j]]++ == 0) {
+                uncover(column_[j]);
+            }
+            ++remaining_[kind_[column_[j]]];
+            ++remaining_tiles_;
+        }
+    }
+
+    // Takes a row out of every column, the branching one included.
+    void remove_row(int row) {
+        for (int j = row_start_[row]; j < row_start_[row + 1]; ++j) {
+            unlink(j);
+        }
+    }
+
+    void restore_row(int row) {
+        for (int j = row_start_[row + 1] - 1; j >= row_start_[row]; --j) {
+            relink(j);
+        }
+    }
+
+    template <typename Visit>
+    bool descend(Visit& visit) {
+        ++nodes_;
+        if (right_[0] == 0) {
+            return visit(chosen_);
+        }
+        if (remaining_tiles_ >= LOOKAHEAD_TILES && !ArrangementSolver::is_arrangeable(remaining_)) {
+            return true; // Nothing below this node covers the rest.
+        }
+        int best = right_[0];
+        int best_score = size_[best] - need_[best];
+        for (int c = right_[best]; c != 0 && size_[best] > 0; c = right_[c]) {
+            int score = size_[c] - need_[c];
+            if (score < best_score || size_[c] == 0) {
+                best = c;
+                best_score = score;
+            }
+        }
+
+        bool keep_going = true;
+        size_t removed_before = removed_.size();
+        while (keep_going && down_[best] != best) {
+            int row = row_[down_[best]];
+            chosen_.push_back(row_entry_[row]);
+            choose(row);
+            keep_going = descend(visit);
+            unchoose(row);
+            chosen_.pop_back();
+            remove_row(row);
+            removed_.push_back(row);
+        }
+        while (removed_.size() > removed_before) {
+            restore_row(removed_.back());
+            removed_.pop_back();
+        }
+        return keep_going;
+    }
+
+    std::pmr::vector<int> left_;  // Headers only.
+    std::pmr::vector<int> right_; // Headers only.
+    std::pmr::vector<int> up_;
+    std::pmr::vector<int> down_;
+    std::pmr::vector<int> column_;    // Header of each node (a header is its own).
+    std::pmr::vector<int> row_;       // Row of each node; -1 for headers.
+    std::pmr::vector<uint8_t> need_;  // Per header: covers still needed.
+    std::pmr::vector<int> size_;      // Per header: rows still linked.
+    std::pmr::vector<int> row_start_; // First node of each row, plus an end marker.
+    std::pmr::vector<uint16_t> row_entry_; // CATALOG index of each row.
+    std::pmr::vector<uint16_t> chosen_;
+    std::pmr::vector<int> removed_; // Rows taken out while branching, restored on the way back.
+    std::pmr::vector<uint8_t> kind_;  // Per header: its tile kind.
+    ArrangementSolver::PoolCounts remaining_{}; // Tiles still to cover, by kind.
+    int remaining_tiles_ = 0;
+    bool coverable_ = false;
+    uint64_t nodes_ = 0;
+};
+
+// Kinds a joker in `pool` could stand for. Every set holds a real tile, and with at most
+// two jokers a joker in a run is within two numbers of a real tile of its color, and a
+// joker in a group has a real tile's number.
+inline TileCode::KindMask stand_in_kinds(const ArrangementSolver::PoolCounts& pool) {
+    TileCode::KindMask kinds = 0;
+    for (int kind = 0; kind < TileCode::NUM_KINDS; ++kind) {
+        if (pool[kind] == 0) {
+            continue;
+        }
+        int number = TileCode::kindNumber(kind);
+        int c = TileCode::kindColor(kind);
+        for (int other = 1; other <= TileCode::NUM_COLORS; ++other) { // Colors are 1-based.
+            kinds |= TileCode::kindBit(TileCode::kindOf(number, other));
+        }
+        for (int n = std::max(1, number - 2); n <= std::min(TileCode::NUM_NUMBERS, number + 2); ++n) {
+            kinds |= TileCode::kindBit(TileCode::kindOf(n, c));
+        }
+    }
+    return kinds;
+}
+
+// Calls visit(pool) with each joker of `pool` replaced by one of `kinds`, at or above
+// `first_kind`, until it returns false; each multiset of stand-ins is visited once, and no
+// kind exceeds two tiles. A pool the DP cannot arrange, with the jokers it still holds,
+// is not substituted further. Returns false if visit asked to stop.
+template <typename Visit>
+inline bool for_each_stand_in(ArrangementSolver::PoolCounts& pool, TileCode::KindMask kinds, int first_kind,
+                              Visit& visit) {
+    if (pool[ArrangementSolver::JOKER_SLOT] == 0) {
+        return visit(pool);
+    }
+    if (!ArrangementSolver::is_arrangeable(pool)) {
+        return true;
+    }
+    --pool[ArrangementSolver::JOKER_SLOT];
+    bool keep_going = true;
+    for (TileCode::KindMask rest = kinds & ~(TileCode::kindBit(first_kind) - 1); keep_going && rest != 0;
+         rest &= rest - 1) {
+        int kind = __builtin_ctzll(rest);
+        if (pool[kind] == ArrangementSolver::MAX_COPIES) {
+            continue;
+        }
+        ++pool[kind];
+        keep_going = for_each_stand_in(pool, kinds, kind, visit);
+        --pool[kind];
+    }
+    ++pool[ArrangementSolver::JOKER_SLOT];
+    return keep_going;
+}
+
+// The sets for a list of catalog indices, in GameSet order, with physical tiles from `supply`.
+template <typename Rows>
+inline std::vector<GameSet> to_arrangement(const Rows& rows, ArrangementSolver::TileSupply& supply,
+                                           std::pmr::memory_resource* memory) {
+    std::pmr::vector<uint16_t> sorted_rows(rows.begin(), rows.end(), memory);
+    std::sort(sorted_rows.begin(), sorted_rows.end());
+    std::vector<GameSet> arrangement;
+    arrangement.reserve(sorted_rows.size());
+    std::pmr::vector<Tile> set_tiles(memory);
+    for (uint16_t index : sorted_rows) {
+        const SetFinder::CatalogEntry& entry = SetFinder::CATALOG[index];
+        set_tiles.clear();
+        for (TileCode::KindMask rest = entry.mask; rest != 0; rest &= rest - 1) {
+            int kind = __builtin_ctzll(rest);
+            set_tiles.push_back(supply.take(TileCode::kindNumber(kind), TileCode::kindColor(kind)));
+        }
+        arrangement.push_back(GameSet(set_tiles.begin(), set_tiles.end(), entry.type));
+    }
+    return arrangement;
+}
+
+// Calls visit(arrangement) for every arrangement of `tiles` until it returns false, and
+// returns how many it was called for. `nodes`, if given, receives the search nodes, summed
+// over the joker substitutions searched.
+template <typename Tiles = std::vector<Tile>, typename Visit>
+inline uint64_t for_each_arrangement(const Tiles& tiles, Visit visit, uint64_t* nodes = nullptr) {
+    TRACE_FUNCTION();
+    uint64_t found = 0;
+    uint64_t searched = 0;
+    std::optional<ArrangementSolver::PoolCounts> counts = ArrangementSolver::to_counts(tiles);
+    bool jokers = counts && (*counts)[ArrangementSolver::JOKER_SLOT] > 0;
+    auto search = [&](const ArrangementSolver::PoolCounts& pool) {
+        if (jokers && !ArrangementSolver::is_arrangeable(pool)) {
+            return true; // Most substitutions leave a tile out; the DP rules them out first.
+        }
+        Arena::Scope scratch;
+        Matrix matrix(pool, scratch.resource());
+        auto on_cover = [&](const std::pmr::vector<uint16_t>& rows) {
+            Arena::Scope per_arrangement; // The matrix's own lists never grow during the search.
+            ArrangementSolver::TileSupply supply(tiles, per_arrangement.resource());
+            ++found;
+            return visit(to_arrangement(rows, supply, per_arrangement.resource()));
+        };
+        bool keep_going = matrix.search(on_cover);
+        searched += matrix.nodes();
+        return keep_going;
+    };
+    if (counts) {
+        for_each_stand_in(*counts, jokers ? stand_in_kinds(*counts) : 0, 0, search);
+    }
+    if (nodes) {
+        *nodes = searched;
+    }
+    return found;
+}
+
+// The first arrangement of `tiles` the search reaches, or std::nullopt if there is none.
+template <typename Tiles = std::vector<Tile>>
+inline std::optional<std::vector<GameSet>> solve(const Tiles& tiles, uint64_t* nodes = nullptr) {
+    TRACE_FUNCTION();
+    std::optional<std::vector<GameSet>> first;
+    for_each_arrangement(tiles, [&first](std::vector<GameSet> arrangement) {
+        first = std::move(arrangement);
+        return false;
+    }, nodes);
+    return first;
+}
+
+} // namespace ExactCover
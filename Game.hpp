@@ -0,0 +1,283 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <random>    // For std::mt19937_64
+#include <algorithm> // For std::clamp, std::upper_bound
+
+#include "Tile.hpp"
+#include "utilities.hpp"         // For the seeded shuffle
+#include "Board.hpp"             // For BoardState
+#include "MoveFinder.hpp"        // For find_best_move
+#include "ArrangementSolver.hpp" // For the points-maximizing initial meld
+#include "PerformanceTracer.hpp" // For TRACE_FUNCTION
+
+// Self-play game engine for 2-4 players.
+//
+// deal() shuffles the 104 numbered tiles and the jokers with a seeded generator, so a seed
+// fully determines a game.
+// Each turn the player either melds, plays, draws one tile or (with an empty pile) passes:
+//   - Until a player has melded, they may only lay down sets made from their own hand worth
+//     at least INITIAL_MELD_POINTS, and may not touch the board on that turn.
+//   - After that, find_best_move decides the play, applied in place by play_best_move. The
+//     engine only needs a valid board, not the canonical one, so it skips the canonical
+//     layout.
+// The game ends when a player empties their hand, when every player passes in a row with
+// the pile empty, or after max_turns. Hands, pile, board and the spare set buffer the moves
+// are laid out in are sized once per Game, and searches take their scratch from the arena,
+// so after the first turn's per-thread buffers are set up a turn allocates nothing.
+
+enum class TurnAction {
+    MELD, // Initial meld from the hand.
+    PLAY, // Tiles added to (and possibly rearranging) the board.
+    DRAW, // No move; took a tile from the pile.
+    PASS  // No move and nothing left to draw.
+};
+
+struct TurnRecord {
+    int player;
+    TurnAction action;
+    int tiles_played;
+};
+
+class Game {
+public:
+    static constexpr int MIN_PLAYERS = 2;
+    static constexpr int MAX_PLAYERS = 4;
+    static constexpr int HAND_SIZE = 14;
+    static constexpr int INITIAL_MELD_POINTS = 30;
+    static constexpr int DEFAULT_MAX_TURNS = 1000;
+    static constexpr int NUM_TILES = TileCode::NUM_KINDS * 2 + TileCode::NUM_JOKERS;
+    static constexpr int JOKER_PENALTY = 30; // Value of a joker left in a hand.
+    static constexpr int MAX_BOARD_SETS = NUM_TILES / 3; // Every set holds three tiles or more.
+    static_assert(MAX_BOARD_SETS == BoardSets::CAPACITY, "A board must hold every set a game can lay out");
+
+    struct Config {
+        int players = MIN_PLAYERS;
+        int jokers = TileCode::NUM_JOKERS;
+        int initial_meld_points = INITIAL_MELD_POINTS;
+        int max_turns = DEFAULT_MAX_TURNS;
+    };
+
+    // Scores are zero-sum: each loser pays the difference between their remaining hand
+    // value and the winner's, so a player who went out collects the losers' hand values.
+    // A blocked game is won by the lowest hand value (earliest seat on ties).
+    struct Result {
+        int winner = -1;
+        int turns = 0;
+        bool blocked = false;
+        std::array<int, MAX_PLAYERS> hand_points{};
+        std::array<int, MAX_PLAYERS> scores{};
+    };
+
+    Game() : Game(Config{}) {}
+
+    explicit Game(const Config& config) : config_(config) {
+        config_.players = std::clamp(config_.players, MIN_PLAYERS, MAX_PLAYERS);
+        config_.jokers = std::clamp(config_.jokers, 0, TileCode::NUM_JOKERS);
+        deck_.reserve(NUM_TILES);
+        for (int kind = 0; kind < TileCode::NUM_KINDS; ++kind) {
+            for (int copy = 0; copy < 2; ++copy) {
+                deck_.push_back(Tile(TileCode::kindNumber(kind), TileCode::kindColor(kind), copy));
+            }
+        }
+        for (int copy = 0; copy < config_.jokers; ++copy) {
+            deck_.push_back(Tile::joker(copy));
+        }
+        pile_.reserve(NUM_TILES);
+        meld_tiles_.reserve(NUM_TILES);
+        for (auto& hand : hands_) {
+            hand.reserve(NUM_TILES);
+        }
+        spare_sets_.reserve(MAX_BOARD_SETS);
+    }
+
+    // Starts a new game: shuffles with `seed`, deals HAND_SIZE tiles to every player and
+    // gives the first turn to player 0.
+    void deal(uint64_t seed) {
+        TRACE_FUNCTION();
+        std::mt19937_64 rng(seed);
+        pile_.assign(deck_.begin(), deck_.end());
+        shuffle(&pile_, rng);
+        for (int p = 0; p < config_.players; ++p) {
+            hands_[p].assign(pile_.end() - HAND_SIZE, pile_.end());
+            pile_.erase(pile_.end() - HAND_SIZE, pile_.end());
+            std::sort(hands_[p].begin(), hands_[p].end());
+        }
+        board_ = BoardState();
+        melded_.fill(false);
+        current_ = 0;
+        idle_turns_ = 0;
+        over_ = false;
+        result_ = Result();
+    }
+
+    // Plays one turn for the current player and passes the turn on.
+    TurnRecord play_turn() {
+        TRACE_FUNCTION();
+        int player = current_;
+        TurnRecord record = {player, TurnAction::PASS, 0};
+        std::vector<Tile>& hand = hands_[player];
+
+        if (!melded_[player]) {
+            record.tiles_played = initial_meld(hand);
+            if (record.tiles_played > 0) {
+                melded_[player] = true;
+                record.action = TurnAction::MELD;
+            }
+        } else {
+            record.tiles_played = MoveFinder::play_best_move(board_, hand, spare_sets_);
+            if (record.tiles_played > 0) {
+                record.action = TurnAction::PLAY;
+            }
+        }
+
+        if (record.tiles_played == 0 && !pile_.empty()) {
+            Tile drawn = pile_.back();
+            pile_.pop_back();
+            hand.insert(std::upper_bound(hand.begin(), hand.end(), drawn), drawn);
+            record.action = TurnAction::DRAW;
+        }
+        idle_turns_ = record.action == TurnAction::PASS ? idle_turns_ + 1 : 0;
+
+        ++result_.turns;
+        if (hand.empty()) {
+            finish(player);
+        } else if (idle_turns_ >= config_.players || result_.turns >= config_.max_turns) {
+            finish(-1);
+        }
+        current_ = (current_ + 1) % config_.players;
+        return record;
+    }
+
+    // Deals with `seed` and plays to the end.
+    const Result& play(uint64_t seed) {
+        TRACE_FUNCTION();
+        deal(seed);
+        while (!over_) {
+            play_turn();
+        }
+        return result_;
+    }
+
+    bool is_over() const {
+        return over_;
+    }
+
+    const Result& result() const {
+        return result_;
+    }
+
+    int players() const {
+        return config_.players;
+    }
+
+    int current_player() const {
+        return current_;
+    }
+
+    bool has_melded(int player) const {
+        return melded_[player];
+    }
+
+    const BoardState& board() const {
+        return board_;
+    }
+
+    const std::vector<Tile>& hand(int player) const {
+        return hands_[player];
+    }
+
+    const std::vector<Tile>& pile() const {
+        return pile_;
+    }
+
+    // Every tile this game is dealt from.
+    const std::vector<Tile>& deck() const {
+        return deck_;
+    }
+
+    // Penalty value of tiles left in a hand.
+    static int points(const std::vector<Tile>& tiles) {
+        int total = 0;
+        for (const auto& tile : tiles) {
+            total += tile.isJoker() ? JOKER_PENALTY : tile.getNumber();
+        }
+        return total;
+    }
+
+private:
+    // Lays down the highest-value sets the hand can form on its own if they reach the
+    // initial-meld threshold (a joker counts as the tile it stands for). Returns the number
+    // of tiles laid down.
+    int initial_meld(std::vector<Tile>& hand) {
+        TRACE_FUNCTION();
+        std::optional<ArrangementSolver::PoolCounts> counts = ArrangementSolver::to_counts(hand);
+        if (!counts) {
+            return 0;
+        }
+        ArrangementSolver::PoolCounts none{};
+        int meld_points = 0;
+        std::optional<ArrangementSolver::PoolCounts> played =
+            ArrangementSolver::max_playable(none, *counts, ArrangementSolver::Objective::POINTS, &meld_points);
+        if (!played || meld_points == 0 || meld_points < config_.initial_meld_points) {
+            return 0;
+        }
+
+        // The hand is sorted, so the lowest copy of each kind goes first.
+        meld_tiles_.clear();
+        ArrangementSolver::PoolCounts left = *played;
+        hand.erase(std::remove_if(hand.begin(), hand.end(), [this, &left](const Tile& tile) {
+            int slot = ArrangementSolver::count_slot(tile);
+            if (left[slot] == 0) {
+                return false;
+            }
+            --left[slot];
+            meld_tiles_.push_back(tile);
+            return true;
+        }), hand.end());
+
+        ArrangementSolver::solve_into(meld_tiles_, spare_sets_);
+        for (const auto& set : spare_sets_) {
+            board_.addSet(set);
+        }
+        return static_cast<int>(meld_tiles_.size());
+    }
+
+    void finish(int winner) {
+        over_ = true;
+        result_.blocked = winner < 0;
+        for (int p = 0; p < config_.players; ++p) {
+            result_.hand_points[p] = points(hands_[p]);
+        }
+        if (winner < 0) {
+            winner = 0;
+            for (int p = 1; p < config_.players; ++p) {
+                if (result_.hand_points[p] < result_.hand_points[winner]) {
+                    winner = p;
+                }
+            }
+        }
+        result_.winner = winner;
+        for (int p = 0; p < config_.players; ++p) {
+            if (p != winner) {
+                result_.scores[p] = result_.hand_points[winner] - result_.hand_points[p];
+                result_.scores[winner] -= result_.scores[p];
+            }
+        }
+    }
+
+    Config config_;
+    std::vector<Tile> deck_;
+    std::vector<Tile> pile_;
+    std::array<std::vector<Tile>, MAX_PLAYERS> hands_;
+    std::vector<Tile> meld_tiles_;
+    BoardState board_;
+    std::vector<GameSet> spare_sets_; // Where moves and melds are laid out before they reach board_.
+    std::array<bool, MAX_PLAYERS> melded_{};
+    int current_ = 0;
+    int idle_turns_ = 0;
+    bool over_ = false;
+    Result result_;
+};
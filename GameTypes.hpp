@@ -1,6 +1,11 @@
 #pragma once
 
 #include <vector>
+#include <array>
+#include <cstdint>
+#include <cstring>     // For std::memcpy
+#include <utility>     // For std::index_sequence
+#include <type_traits> // For std::is_trivially_copyable_v
 #include <algorithm> // For std::sort, std::all_of
 #include <iostream>  // For GameSet::print
 #include <set>       // For GameSet internal checks if any, or if used by isValid functions
@@ -8,6 +13,7 @@
 #include "Tile.hpp"
 #include "runs.hpp"   // For isValidRun
 #include "groups.hpp" // For isValidGroup
+#include "SetValidator.hpp" // For SetType and the mask-based validity check
 #include "PerformanceTracer.hpp" // For performance tracing
 #include <optional> // For std::optional - though Move struct will be relocated
 // utilities.hpp might be needed if GameSet used functions from it, currently doesn't seem to.
@@ -15,30 +21,79 @@
 
 // BoardState forward declaration removed as Move struct is being relocated.
 
-enum class SetType {
-    RUN,
-    GROUP
+// The tiles of one set, sorted and stored inline. No set holds more than 13 tiles (a run
+// through every number), so a GameSet needs no heap memory and copies as plain bytes.
+// Slots past size() hold code 0, which lets GameSet compare whole sets a word at a time.
+// A range longer than CAPACITY can never be a set; it is stored as an empty (invalid) set.
+class SetTiles {
+public:
+    static constexpr size_t CAPACITY = TileCode::NUM_NUMBERS;
+
+    using value_type = Tile;
+    using iterator = Tile*;
+    using const_iterator = const Tile*;
+
+    SetTiles() = default;
+
+    template <typename Iterator>
+    SetTiles(Iterator first, Iterator last) {
+        for (; first != last; ++first) {
+            if (size_ == CAPACITY) {
+                *this = SetTiles();
+                return;
+            }
+            items_[size_++] = *first;
+        }
+        std::sort(begin(), end());
+    }
+
+    iterator begin() { return items_.data(); }
+    iterator end() { return items_.data() + size_; }
+    const_iterator begin() const { return items_.data(); }
+    const_iterator end() const { return items_.data() + size_; }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const Tile& operator[](size_t i) const { return items_[i]; }
+    const Tile& front() const { return items_[0]; }
+    const Tile& back() const { return items_[size_ - 1]; }
+
+    // For code that still takes a std::vector<Tile>.
+    operator std::vector<Tile>() const {
+        return std::vector<Tile>(begin(), end());
+    }
+
+    bool operator==(const SetTiles& other) const {
+        return size_ == other.size_ && items_ == other.items_;
+    }
+
+private:
+    template <size_t... I>
+    static constexpr std::array<Tile, CAPACITY> padding(std::index_sequence<I...>) {
+        return {{(static_cast<void>(I), Tile::fromCode(0))...}};
+    }
+
+    std::array<Tile, CAPACITY> items_ = padding(std::make_index_sequence<CAPACITY>());
+    uint8_t size_ = 0;
 };
 
 class GameSet {
 public:
-    std::vector<Tile> tiles;
+    SetTiles tiles;
     SetType type;
 
-    GameSet(const std::vector<Tile>& t, SetType st) : tiles(t), type(st) {
-        std::sort(this->tiles.begin(), this->tiles.end());
-    }
+    // An empty run, which is never valid; fills the unused slots of a board.
+    GameSet() : type(SetType::RUN) {}
+
+    GameSet(const std::vector<Tile>& t, SetType st) : tiles(t.begin(), t.end()), type(st) {}
+
+    // From any range of tiles, e.g. an arena-backed scratch vector.
+    template <typename Iterator>
+    GameSet(Iterator first, Iterator last, SetType st) : tiles(first, last), type(st) {}
 
     bool isValid() const {
         TRACE_FUNCTION();
-        if (tiles.empty()) {
-            return false;
-        }
-        if (type == SetType::RUN) {
-            return isValidRun(tiles);
-        } else { // SetType::GROUP
-            return isValidGroup(tiles);
-        }
+        return SetValidator::is_valid(SetValidator::encode(tiles, type));
     }
 
     void print() const {
@@ -51,20 +106,36 @@ public:
         std::cout << std::endl;
     }
 
+    // Both comparisons read the set as two overlapping 8-byte words: the zero-padded tiles,
+    // then the size and type. Zero padding plus the size as a tie-break orders sets like
+    // comparing their sorted tile vectors.
     bool operator==(const GameSet& other) const {
-        if (type != other.type || tiles.size() != other.tiles.size()) {
-            return false;
-        }
-        return tiles == other.tiles; // Relies on Tile::operator== and sorted tiles
+        return words() == other.words();
     }
 
     bool operator<(const GameSet& other) const {
         if (type != other.type) {
-            return static_cast<int>(type) < static_cast<int>(other.type);
+            return type < other.type;
         }
-        return tiles < other.tiles; // Relies on Tile::operator< and sorted tiles
+        return words() < other.words();
+    }
+
+private:
+    // Big-endian, so comparing the words compares the bytes in order.
+    std::pair<uint64_t, uint64_t> words() const {
+        uint64_t high, low;
+        std::memcpy(&high, this, sizeof(high));
+        std::memcpy(&low, reinterpret_cast<const unsigned char*>(this) + sizeof(GameSet) - sizeof(low), sizeof(low));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        high = __builtin_bswap64(high);
+        low = __builtin_bswap64(low);
+#endif
+        return {high, low};
     }
 };
 
+static_assert(sizeof(GameSet) == SetTiles::CAPACITY + 2, "GameSet must stay tiles, size and type with no padding");
+static_assert(std::is_trivially_copyable_v<GameSet>, "GameSet must copy as plain bytes");
+
 // Move struct definition removed from here. It will be placed in Board.hpp
 // after BoardState is fully defined.
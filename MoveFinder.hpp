@@ -3,20 +3,30 @@
 #include <vector>
 #include <algorithm> // For std::sort, std::next_permutation, std::remove_if
 #include <optional>  // For std::optional
-#include <set>       // For std::set to handle tile uniqueness when calculating remaining hand
+#include <chrono>    // For the anytime search's deadline
+#include <memory_resource> // For arena-backed scratch
 
 #include "GameTypes.hpp"         // For Move, Tile, BoardState
 #include "Board.hpp"             // For BoardManipulation::can_add_tiles_to_board and BoardState
+#include "ArrangementSolver.hpp" // For the single-pass max_playable optimization
+#include "SetFinder.hpp"         // For the catalog behind the anytime search's first move
 #include "PerformanceTracer.hpp" // For TRACE_FUNCTION
+#include "ThreadPool.hpp"        // For find_best_move's parallel layout probes
+#include "Arena.hpp"             // For search-scoped scratch memory
 
 namespace MoveFinder {
 
+// Largest hand whose subsets are enumerated (2^20 of them); beyond it the count no longer
+// fits in memory, let alone in the shifts below.
+constexpr size_t MAX_SUBSET_HAND_SIZE = 20;
+
 // Helper function to generate all non-empty subsets of a given set of tiles.
-// Subsets are returned sorted by size in descending order.
+// Subsets are returned sorted by size in descending order. Hands larger than
+// MAX_SUBSET_HAND_SIZE get no subsets.
 std::vector<std::vector<Tile>> generate_tile_subsets_descending(const std::vector<Tile>& tiles) {
     TRACE_FUNCTION();
     std::vector<std::vector<Tile>> all_subsets;
-    if (tiles.empty()) {
+    if (tiles.empty() || tiles.size() > MAX_SUBSET_HAND_SIZE) {
         return all_subsets;
     }
 
@@ -36,8 +46,9 @@ std::vector<std::vector<Tile>> generate_tile_subsets_descending(const std::vecto
         all_subsets.push_back(current_subset);
     }
 
-    // Sort subsets by size in descending order
-    std::sort(all_subsets.begin(), all_subsets.end(), [](const std::vector<Tile>& a, const std::vector<Tile>& b) {
+    // Sort subsets by size in descending order. The sort is stable so that subsets of one size
+    // stay in mask order.
+    std::stable_sort(all_subsets.begin(), all_subsets.end(), [](const std::vector<Tile>& a, const std::vector<Tile>& b) {
         return a.size() > b.size();
     });
 
@@ -64,55 +75,307 @@ std::vector<Tile> calculate_remaining_hand(const std::vector<Tile>& original_han
 }
 
 
+// The hand tiles the best move plays, appended to `played` in ascending order: one DP
+// sweep maximizes the hand tiles placed while every board tile stays placed. False if the
+// board itself cannot be arranged or `budget` runs out. Scratch comes from `memory` (an
+// arena scope, which `played` may share), so nothing here touches the heap.
+template <typename Tiles>
+bool choose_tiles_to_play(
+    const BoardState& current_board_state,
+    const std::vector<Tile>& current_hand,
+    Tiles& played,
+    std::pmr::memory_resource* memory,
+    ArrangementSolver::Budget* budget = nullptr) {
+    TRACE_FUNCTION();
+
+    ArrangementSolver::PoolCounts required{};
+    for (const auto& set : current_board_state.sets) {
+        for (const auto& tile : set.tiles) {
+            int slot = ArrangementSolver::count_slot(tile);
+            if (slot < 0 || required[slot] == ArrangementSolver::MAX_COPIES) {
+                return false;
+            }
+            ++required[slot];
+        }
+    }
+
+    std::pmr::vector<Tile> sorted_hand(current_hand.begin(), current_hand.end(), memory);
+    std::sort(sorted_hand.begin(), sorted_hand.end());
+
+    // A hand tile is optional unless it cannot be placed at all: outside the 52 kinds (jokers
+    // aside), a physical tile already on the board (or twice in the hand), or a third copy.
+    ArrangementSolver::PoolCounts optional{};
+    std::pmr::vector<Tile> candidates(memory);
+    candidates.reserve(sorted_hand.size());
+    for (size_t i = 0; i < sorted_hand.size(); ++i) {
+        const Tile& tile = sorted_hand[i];
+        int slot = ArrangementSolver::count_slot(tile);
+        if (slot < 0 || current_board_state.holds(tile) || (i > 0 && sorted_hand[i - 1] == tile) ||
+            required[slot] + optional[slot] >= ArrangementSolver::MAX_COPIES) {
+            continue;
+        }
+        ++optional[slot];
+        candidates.push_back(tile);
+    }
+
+    std::optional<ArrangementSolver::PoolCounts> counts =
+        ArrangementSolver::max_playable(required, optional, ArrangementSolver::Objective::TILES, nullptr, budget);
+    if (!counts) {
+        return false;
+    }
+
+    // candidates is sorted, so the lowest copies of each kind are played first.
+    ArrangementSolver::PoolCounts taken{};
+    for (const auto& tile : candidates) {
+        int slot = ArrangementSolver::count_slot(tile);
+        if (taken[slot] < (*counts)[slot]) {
+            ++taken[slot];
+            played.push_back(tile);
+        }
+    }
+    return true;
+}
+
 // Finds the best move for a player given the current board state and their hand.
 // The "best" move is defined as the one that plays the most tiles from the player's hand.
 // Returns std::nullopt if no move is possible.
+// choose_tiles_to_play picks the tiles; the board for them is then rebuilt with
+// can_add_tiles_to_board (see there for canonical_layout). Both steps draw on `budget`, if
+// given; when it runs out the result is std::nullopt (find_best_move_anytime keeps a
+// fallback for that case). `threads` spreads the canonical layout's probes over a pool
+// (see find_best_move_parallel).
 std::optional<Move> find_best_move(
     const BoardState& current_board_state,
-    const std::vector<Tile>& current_hand) {
+    const std::vector<Tile>& current_hand,
+    bool canonical_layout = true,
+    ArrangementSolver::Budget* budget = nullptr,
+    ThreadPool* threads = nullptr) {
     TRACE_FUNCTION();
 
     if (current_hand.empty()) {
         return std::nullopt; // Cannot make a move with an empty hand.
     }
 
+    std::vector<Tile> tiles_to_play;
+    {
+        Arena::Scope scratch;
+        std::pmr::vector<Tile> played(scratch.resource());
+        if (!choose_tiles_to_play(current_board_state, current_hand, played, scratch.resource(), budget)) {
+            return std::nullopt;
+        }
+        tiles_to_play.assign(played.begin(), played.end());
+    }
+
+    std::optional<BoardState> new_board_state =
+        BoardManipulation::can_add_tiles_to_board(current_board_state, tiles_to_play, canonical_layout, budget, threads);
+    if (!new_board_state) {
+        return std::nullopt; // Also covers playing zero tiles.
+    }
+    std::vector<Tile> remaining_hand = calculate_remaining_hand(current_hand, tiles_to_play);
+    return Move(*new_board_state, remaining_hand, static_cast<int>(tiles_to_play.size()));
+}
+
+// find_best_move for self-play, applied in place: the tiles played leave `hand`, which
+// comes back sorted, and `board` takes the DP's own arrangement (canonical_layout = false).
+// Returns how many tiles were played; 0 if there is no move, with both left untouched.
+// `spare_sets` is a buffer the caller keeps between calls: the DP lays the new board out
+// there before it is copied onto `board`, so once it holds a full board's capacity (and
+// `hand` its own) a call does not allocate. The result is find_best_move(board, hand,
+// false)'s Move.
+int play_best_move(BoardState& board, std::vector<Tile>& hand, std::vector<GameSet>& spare_sets) {
+    TRACE_FUNCTION();
+
+    if (hand.empty()) {
+        return 0;
+    }
+
+    Arena::Scope scratch;
+    std::pmr::vector<Tile> played(scratch.resource());
+    if (!choose_tiles_to_play(board, hand, played, scratch.resource()) || played.empty()) {
+        return 0;
+    }
+
+    std::pmr::vector<Tile> combined_pool(scratch.resource());
+    for (const auto& set : board.sets) {
+        combined_pool.insert(combined_pool.end(), set.tiles.begin(), set.tiles.end());
+    }
+    combined_pool.insert(combined_pool.end(), played.begin(), played.end());
+    if (!ArrangementSolver::solve_into(combined_pool, spare_sets) || !is_board_valid(spare_sets)) {
+        return 0;
+    }
+    board.assignSets(spare_sets);
+
+    for (const auto& tile : played) {
+        hand.erase(std::find(hand.begin(), hand.end(), tile));
+    }
+    std::sort(hand.begin(), hand.end());
+    return static_cast<int>(played.size());
+}
+
+// A move that needs no search: the board stays as it is and sets made from the hand alone
+// are laid down next to it, greedily, longest first (catalog order among equals).
+// std::nullopt if the hand holds no set.
+std::optional<Move> find_hand_sets_move(
+    const BoardState& current_board_state,
+    const std::vector<Tile>& current_hand) {
+    TRACE_FUNCTION();
+
+    std::vector<Tile> sorted_hand = current_hand;
+    std::sort(sorted_hand.begin(), sorted_hand.end());
+
+    // Only tiles that could join the board: not already on it, and not repeated in the hand.
+    std::vector<Tile> free_tiles;
+    for (size_t i = 0; i < sorted_hand.size(); ++i) {
+        if (!current_board_state.holds(sorted_hand[i]) && (i == 0 || sorted_hand[i - 1] != sorted_hand[i])) {
+            free_tiles.push_back(sorted_hand[i]);
+        }
+    }
+
+    BoardState new_board_state = current_board_state;
+    std::vector<Tile> played;
+    while (true) {
+        TileCode::KindMask pool = SetFinder::pool_mask(free_tiles);
+        const SetFinder::CatalogEntry* longest = nullptr;
+        for (const auto& entry : SetFinder::CATALOG) {
+            if (SetFinder::can_form(entry, pool) && (!longest || entry.size > longest->size)) {
+                longest = &entry;
+            }
+        }
+        if (!longest) {
+            break;
+        }
+        std::vector<Tile> set_tiles;
+        for (TileCode::KindMask rest = longest->mask; rest != 0; rest &= rest - 1) {
+            int kind = __builtin_ctzll(rest);
+            auto it = std::find_if(free_tiles.begin(), free_tiles.end(),
+                                   [kind](const Tile& tile) { return tile.getKind() == kind; });
+            set_tiles.push_back(*it);
+            free_tiles.erase(it);
+        }
+        new_board_state.addSet(GameSet(set_tiles, longest->type));
+        played.insert(played.end(), set_tiles.begin(), set_tiles.end());
+    }
+
+    if (played.empty() || !new_board_state.isValidBoard()) {
+        return std::nullopt;
+    }
+    std::vector<Tile> remaining_hand = calculate_remaining_hand(sorted_hand, played);
+    return Move(new_board_state, remaining_hand, static_cast<int>(played.size()));
+}
+
+// Limits for find_best_move_anytime; either, both or neither may be set.
+struct SearchLimits {
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+    uint64_t max_nodes = 0; // DP states to expand; 0 means no limit.
+};
+
+struct SearchResult {
+    std::optional<Move> move;    // Best move found; std::nullopt if there is none.
+    bool proven_optimal = false; // The tile choice finished: move plays as many tiles as
+                                 // find_best_move's, and is its answer unless the budget ran
+                                 // out during the canonical layout.
+    uint64_t nodes = 0;          // DP states expanded.
+};
+
+// find_best_move with bounded latency. It starts from find_hand_sets_move, which costs no
+// search, then chooses the tiles to play within `limits`. If that finishes, the choice is
+// optimal (or proves there is no move) and is the result: it is laid out within what is
+// left of `limits`, or, if that runs out, with the DP's own arrangement, which costs one
+// more sweep outside the limits. If the choice does not finish, the hand-sets move stands
+// and proven_optimal is false. The deadline is checked every Budget::CLOCK_INTERVAL nodes.
+SearchResult find_best_move_anytime(
+    const BoardState& current_board_state,
+    const std::vector<Tile>& current_hand,
+    const SearchLimits& limits,
+    bool canonical_layout = true) {
+    TRACE_FUNCTION();
+
+    SearchResult result;
+    if (current_hand.empty()) {
+        result.proven_optimal = true; // Cannot make a move with an empty hand.
+        return result;
+    }
+    result.move = find_hand_sets_move(current_board_state, current_hand);
+
+    ArrangementSolver::Budget budget(limits.max_nodes, limits.deadline);
+    std::vector<Tile> tiles_to_play;
+    bool chosen = false;
+    {
+        Arena::Scope scratch;
+        std::pmr::vector<Tile> played(scratch.resource());
+        chosen = choose_tiles_to_play(current_board_state, current_hand, played, scratch.resource(), &budget);
+        tiles_to_play.assign(played.begin(), played.end());
+    }
+    if (!chosen && budget.exhausted()) {
+        result.nodes = budget.nodes();
+        return result;
+    }
+
+    std::optional<BoardState> new_board_state;
+    if (chosen) {
+        new_board_state = BoardManipulation::can_add_tiles_to_board(current_board_state, tiles_to_play,
+                                                                    canonical_layout, &budget);
+        if (!new_board_state && budget.exhausted()) {
+            new_board_state = BoardManipulation::can_add_tiles_to_board(current_board_state, tiles_to_play, false);
+        }
+    }
+    result.nodes = budget.nodes();
+    result.proven_optimal = true;
+    if (!new_board_state) {
+        result.move = std::nullopt; // Also covers playing zero tiles.
+        return result;
+    }
+    std::vector<Tile> remaining_hand = calculate_remaining_hand(current_hand, tiles_to_play);
+    result.move = Move(*new_board_state, remaining_hand, static_cast<int>(tiles_to_play.size()));
+    return result;
+}
+
+// Reference implementation: probes every subset of the hand, largest first, with
+// can_add_tiles_to_board. Exponential in the hand size; kept to cross-check find_best_move.
+// Hands larger than MAX_SUBSET_HAND_SIZE are rejected with std::nullopt.
+std::optional<Move> find_best_move_by_subsets(
+    const BoardState& current_board_state,
+    const std::vector<Tile>& current_hand) {
+    TRACE_FUNCTION();
+
+    if (current_hand.empty() || current_hand.size() > MAX_SUBSET_HAND_SIZE) {
+        return std::nullopt; // Cannot make a move with an empty hand; too many subsets to probe.
+    }
+
     std::vector<Tile> sorted_hand = current_hand; // Work with a sorted copy
     std::sort(sorted_hand.begin(), sorted_hand.end());
 
     std::vector<std::vector<Tile>> hand_subsets = generate_tile_subsets_descending(sorted_hand);
 
-    // std::vector<Tile> initial_board_tiles = current_board_state.getAllTiles(); // No longer needed for comparison here
-    // std::cout << "find_best_move: Starting with hand size " << sorted_hand.size() << std::endl;
-
     for (const auto& tiles_to_try_playing : hand_subsets) {
         if (tiles_to_try_playing.empty()) {
             continue;
         }
 
-        // std::cout << "find_best_move: Trying to play subset of size " << tiles_to_try_playing.size() << ": ";
-        // for(const auto& t : tiles_to_try_playing) { t.print(); std::cout << " "; }
-        // std::cout << std::endl;
-
         // Attempt to add these tiles to the board
         std::optional<BoardState> potential_new_board_state_opt = BoardManipulation::can_add_tiles_to_board(current_board_state, tiles_to_try_playing);
 
-        // if (potential_new_board_state_opt) {
-        //     std::cout << "find_best_move: SUCCESS with subset size " << tiles_to_try_playing.size() << std::endl;
-        //     // Successfully played this subset of tiles
-        //     // The can_add_tiles_to_board function now guarantees that if it returns a BoardState,
-        //     // it's valid and incorporates the tiles_to_try_playing.
-        //     std::vector<Tile> remaining_hand = calculate_remaining_hand(sorted_hand, tiles_to_try_playing);
-        //     return Move(*potential_new_board_state_opt, remaining_hand, static_cast<int>(tiles_to_try_playing.size()));
-        // } else {
-        //     std::cout << "find_best_move: FAILED with subset size " << tiles_to_try_playing.size() << std::endl;
-        // }
         if (potential_new_board_state_opt) {
             std::vector<Tile> remaining_hand = calculate_remaining_hand(sorted_hand, tiles_to_try_playing);
             return Move(*potential_new_board_state_opt, remaining_hand, static_cast<int>(tiles_to_try_playing.size()));
         }
     }
-    // std::cout << "find_best_move: No move found after trying all subsets." << std::endl;
     return std::nullopt; // No valid move found
 }
 
+// find_best_move with the work that splits spread over a work-stealing pool. The DP sweep
+// that picks the tiles to play is a single pass and stays on the calling thread; the
+// canonical layout of the new board then takes, for each set it places, the first catalog
+// set through the lowest remaining tile that leaves an arrangeable pool. Those candidates
+// are probed concurrently, later ones are cancelled once an earlier one succeeds, and the
+// lowest success wins, so the Move is exactly find_best_move's. Pools under
+// ArrangementSolver::PARALLEL_MIN_TILES are laid out serially.
+std::optional<Move> find_best_move_parallel(
+    const BoardState& current_board_state,
+    const std::vector<Tile>& current_hand,
+    ThreadPool& pool = ThreadPool::instance()) {
+    TRACE_FUNCTION();
+    return find_best_move(current_board_state, current_hand, true, nullptr, &pool);
+}
+
 } // namespace MoveFinder
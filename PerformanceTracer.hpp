@@ -3,88 +3,972 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <array>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
 #include <chrono>
-#include <iomanip> // For std::fixed and std::setprecision
+#include <cstdint>
+#include <cstring>   // For std::strcmp
+#include <algorithm> // For std::find, std::sort, std::replace
+#include <iomanip>   // For std::fixed and std::setprecision
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h> // For __rdtsc
+#endif
+#ifdef __linux__
+#include <cerrno>
+#include <linux/perf_event.h> // For hardware counters
+#include <sys/syscall.h>      // For SYS_perf_event_open
+#include <unistd.h>           // For read, close
+#endif
 
 // To enable tracing, define ENABLE_PERFORMANCE_TRACING before including this header,
 // or pass it as a compiler flag (e.g., -DENABLE_PERFORMANCE_TRACING)
-
-#ifdef ENABLE_PERFORMANCE_TRACING
+//
+// Every traced scope has a function-local static Scope, registered once under a lock the
+// first time it runs; scopes with the same name share an id. After that a traced call only
+// reads the time-stamp counter twice and updates its thread's own call tree, so threads
+// never contend and nothing is allocated. Ticks are converted to nanoseconds at report
+// time against steady_clock. Trees of exited threads are folded into a retired tree, and
+// all trees are merged by call path when a report is taken.
+//
+// The call tree has one node per call path. Recursion is folded: a scope entered while it
+// is already active (directly or through other scopes) counts a call on its active node
+// and becomes the current node again, so the recursion's callees hang under the outermost
+// frame and only that frame is timed. Inclusive time is therefore never counted twice, and
+// a node's exclusive time is its inclusive time minus its children's.
+//
+// Between start_timeline() and stop_timeline(), every timed frame is also appended to its
+// thread's event buffer, for write_chrome_trace(). Folded recursion shows as one span.
+// write_folded_stacks() writes the call tree in the folded format flame graph tools read.
+//
+// With hardware counters enabled (enable_hardware_counters(), or build with
+// ENABLE_HARDWARE_COUNTERS), every timed frame also reads the thread's perf_event group of
+// cycles, instructions, L1D read misses, LLC misses and branch misses, and adds the deltas
+// to its node. That costs two read() syscalls per frame, so it is meant for focused runs.
+// Counters the kernel or container refuses are reported as unavailable and the tracer
+// carries on with times only.
+//
+// A translation unit that includes AllocationHook.hpp (the test binary does with ALLOC=1)
+// routes every operator new through note_allocation(), which charges
+// the allocation to the calling thread's innermost active node.
+//
+// The tracer itself is always compiled; only TRACE_FUNCTION / TRACE_SCOPE turn into no-ops
+// when tracing is disabled.
 
 namespace PerformanceTracer {
 
+constexpr size_t MAX_SCOPES = 1024;  // Further scopes share the last id.
+constexpr uint32_t MAX_NODES = 4096; // Per thread; calls on new paths beyond it go untraced.
+constexpr uint32_t NO_NODE = UINT32_MAX;
+constexpr uint32_t ROOT_SCOPE = UINT32_MAX;
+constexpr uint32_t MAX_TIMELINE_EVENTS = 1 << 16; // Per thread; later frames are dropped.
+
+using Clock = std::chrono::steady_clock;
+
+// Cheapest monotonic timestamp available: the TSC on x86 (invariant on anything recent),
+// steady_clock nanoseconds elsewhere.
+inline uint64_t now_ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now().time_since_epoch()).count());
+#endif
+}
+
+enum Counter { CYCLES, INSTRUCTIONS, L1D_MISSES, LLC_MISSES, BRANCH_MISSES, NUM_COUNTERS };
+
+inline const char* counter_name(int counter) {
+    static const char* names[NUM_COUNTERS] = {"Cycles", "Instructions", "L1D Misses", "LLC Misses", "Branch Misses"};
+    return names[counter];
+}
+
+using CounterValues = std::array<uint64_t, NUM_COUNTERS>;
+
+#ifdef ENABLE_HARDWARE_COUNTERS
+inline std::atomic<bool> hardware_counters_enabled{true};
+#else
+inline std::atomic<bool> hardware_counters_enabled{false};
+#endif
+
+// One thread's perf_event group, opened on first use. Counters that fail to open are
+// left out of the group; the first failure's errno is kept for the report.
+class PerfCounters {
+public:
+    PerfCounters() {
+        fds_.fill(-1);
+    }
+
+    ~PerfCounters() {
+#ifdef __linux__
+        for (int fd : fds_) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool opened() const {
+        return opened_;
+    }
+
+    // Bit c is set if counter c is being counted.
+    uint32_t available() const {
+        return available_;
+    }
+
+    int error() const {
+        return error_;
+    }
+
+    void open() {
+        opened_ = true;
+#ifdef __linux__
+        struct Event {
+            uint32_t type;
+            uint64_t config;
+        };
+        static const Event events[NUM_COUNTERS] = {
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                 (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        };
+        for (int counter = 0; counter < NUM_COUNTERS; ++counter) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = events[counter].type;
+            attr.config = events[counter].config;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP;
+            int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader_, PERF_FLAG_FD_CLOEXEC));
+            if (fd < 0) {
+                error_ = error_ ? error_ : errno;
+                continue;
+            }
+            if (leader_ < 0) {
+                leader_ = fd;
+            }
+            fds_[counter] = fd;
+            slot_[counter] = members_++;
+            available_ |= 1u << counter;
+        }
+#endif
+    }
+
+    // Current totals of the group; false if no counter is open.
+    bool read(CounterValues& values) {
+#ifdef __linux__
+        if (leader_ < 0) {
+            return false;
+        }
+        uint64_t buffer[1 + NUM_COUNTERS];
+        ssize_t expected = static_cast<ssize_t>(sizeof(uint64_t) * (1 + members_));
+        if (::read(leader_, buffer, sizeof(buffer)) < expected) {
+            return false;
+        }
+        for (int counter = 0; counter < NUM_COUNTERS; ++counter) {
+            values[counter] = fds_[counter] >= 0 ? buffer[1 + slot_[counter]] : 0;
+        }
+        return true;
+#else
+        (void)values;
+        return false;
+#endif
+    }
+
+private:
+    bool opened_ = false;
+    int leader_ = -1;
+    int members_ = 0;
+    uint32_t available_ = 0;
+    int error_ = 0;
+    std::array<int, NUM_COUNTERS> fds_;
+    std::array<int, NUM_COUNTERS> slot_{};
+};
+
+// Per-name totals. total_nanoseconds and counters are inclusive, with recursion counted once.
 struct FunctionProfile {
-    long long total_nanoseconds;
-    long long call_count;
-    std::chrono::time_point<std::chrono::high_resolution_clock> start_time; // Temporary for nested calls
+    std::string name;
+    uint64_t call_count = 0;
+    uint64_t total_nanoseconds = 0;
+    uint64_t exclusive_nanoseconds = 0;
+    CounterValues counters{};
+    uint64_t allocations = 0;
+    uint64_t allocated_bytes = 0;
+    uint64_t exclusive_allocations = 0;
+};
 
-    FunctionProfile() : total_nanoseconds(0), call_count(0) {}
+struct CallNode {
+    std::string name; // Empty for the root.
+    uint64_t call_count = 0;
+    uint64_t inclusive_nanoseconds = 0;
+    uint64_t exclusive_nanoseconds = 0;
+    CounterValues counters{}; // Inclusive.
+    uint64_t allocations = 0; // Inclusive.
+    uint64_t allocated_bytes = 0; // Inclusive.
+    uint64_t exclusive_allocations = 0;
+    std::vector<CallNode> children; // Most inclusive time first.
 };
 
-// Global map to store function profiles
-inline std::map<std::string, FunctionProfile>& get_profiles() {
-    static std::map<std::string, FunctionProfile> profiles;
-    return profiles;
+// A node of one thread's tree. Counters are only written by the owning thread; they are
+// atomics so that a report can read them while it runs (relaxed load + store compiles to
+// plain moves). scope and parent are written before the node is published.
+struct ThreadNode {
+    uint32_t scope = ROOT_SCOPE;
+    uint32_t parent = NO_NODE;
+    uint32_t first_child = NO_NODE; // Links are only followed by the owning thread.
+    uint32_t next_sibling = NO_NODE;
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> ticks{0};
+    std::array<std::atomic<uint64_t>, NUM_COUNTERS> counters{};
+    std::atomic<uint64_t> allocations{0}; // Made while this node was innermost.
+    std::atomic<uint64_t> allocated_bytes{0};
+
+    void add_allocation(uint64_t bytes) {
+        allocations.store(allocations.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        allocated_bytes.store(allocated_bytes.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+    }
+
+    void add_counters(const CounterValues& start, const CounterValues& end) {
+        for (int counter = 0; counter < NUM_COUNTERS; ++counter) {
+            counters[counter].store(counters[counter].load(std::memory_order_relaxed) + (end[counter] - start[counter]),
+                                    std::memory_order_relaxed);
+        }
+    }
+
+    void add_call() {
+        calls.store(calls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void add_ticks(uint64_t elapsed) {
+        ticks.store(ticks.load(std::memory_order_relaxed) + elapsed, std::memory_order_relaxed);
+    }
+};
+
+struct TimelineEvent {
+    uint32_t scope;
+    uint64_t start_ticks;
+    uint64_t end_ticks;
+};
+
+// Events are published like nodes: written, then counted with a release store.
+struct ThreadTree {
+    std::array<ThreadNode, MAX_NODES> nodes;
+    std::atomic<uint32_t> node_count{1}; // Node 0 is the root.
+    uint32_t thread_number = 0;          // Attach order, used as the trace's tid.
+    std::unique_ptr<TimelineEvent[]> event_storage; // Allocated by the registry, kept for life.
+    std::atomic<TimelineEvent*> events{nullptr};    // Set while the thread may record.
+    std::atomic<uint32_t> event_count{0};
+    std::atomic<uint64_t> dropped_events{0};
+
+    void record(uint32_t scope, uint64_t start_ticks, uint64_t end_ticks) {
+        TimelineEvent* buffer = events.load(std::memory_order_acquire);
+        uint32_t count = event_count.load(std::memory_order_relaxed);
+        if (!buffer) {
+            return;
+        }
+        if (count == MAX_TIMELINE_EVENTS) {
+            dropped_events.store(dropped_events.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+        buffer[count] = {scope, start_ticks, end_ticks};
+        event_count.store(count + 1, std::memory_order_release);
+    }
+};
+
+inline std::atomic<bool> timeline_recording{false};
+
+// Tree keyed by call path, used to merge threads.
+struct MergedNode {
+    uint32_t scope = 0;
+    uint64_t calls = 0;
+    uint64_t ticks = 0;
+    CounterValues counters{};
+    uint64_t allocations = 0;
+    uint64_t allocated_bytes = 0;
+    std::vector<size_t> children{};
+};
+
+class Registry {
+public:
+    // Never destroyed: a thread's state detaches when the thread exits, and a pool worker
+    // can exit from a static destructor (its pool's) that runs after the registry's would.
+    static Registry& instance() {
+        static Registry* registry = new Registry;
+        return *registry;
+    }
+
+    uint32_t register_scope(const char* name) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t id = 0; id < scope_count_; ++id) {
+            if (std::strcmp(names_[id], name) == 0) {
+                return static_cast<uint32_t>(id);
+            }
+        }
+        if (scope_count_ == MAX_SCOPES) {
+            return MAX_SCOPES - 1;
+        }
+        names_[scope_count_] = name;
+        return static_cast<uint32_t>(scope_count_++);
+    }
+
+    void attach(ThreadTree* tree) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tree->thread_number = next_thread_number_++;
+        if (timeline_recording.load(std::memory_order_relaxed)) {
+            open_timeline(*tree);
+        }
+        trees_.push_back(tree);
+    }
+
+    void detach(ThreadTree* tree) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fold(*tree, retired_);
+        collect_events(*tree, retired_events_);
+        trees_.erase(std::find(trees_.begin(), trees_.end(), tree));
+    }
+
+    // Clears every event buffer and starts recording. Meant for when no traced code is
+    // running, like reset().
+    void start_timeline() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        retired_events_.clear();
+        for (ThreadTree* tree : trees_) {
+            open_timeline(*tree);
+        }
+        timeline_recording.store(true, std::memory_order_release);
+    }
+
+    void stop_timeline() {
+        timeline_recording.store(false, std::memory_order_release);
+    }
+
+    // Called once per thread after it opens its perf counters.
+    void note_counters(const PerfCounters& counters) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        available_counters_ |= counters.available();
+        if (counters.error() && counter_error_.empty()) {
+            counter_error_ = std::string("perf_event_open: ") + std::strerror(counters.error());
+        }
+    }
+
+    uint32_t available_counters() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return available_counters_;
+    }
+
+    std::string counter_error() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return counter_error_;
+    }
+
+    // Chrome trace-event JSON (chrome://tracing, Perfetto, speedscope): a B/E pair per
+    // recorded frame, timestamps in microseconds since the registry started.
+    void write_chrome_trace(std::ostream& out) {
+        double ns_per_tick = nanoseconds_per_tick();
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<ThreadEvents> threads = retired_events_;
+        for (const ThreadTree* tree : trees_) {
+            collect_events(*tree, threads);
+        }
+
+        out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        bool first = true;
+        auto separator = [&]() -> std::ostream& {
+            out << (first ? "\n" : ",\n");
+            first = false;
+            return out;
+        };
+        auto microseconds = [&](uint64_t ticks) {
+            return ticks > start_ticks_ ? (ticks - start_ticks_) * ns_per_tick / 1000 : 0.0;
+        };
+        out << std::fixed << std::setprecision(3);
+        for (auto& thread : threads) {
+            separator() << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.thread_number
+                        << ",\"args\":{\"name\":\"thread " << thread.thread_number << "\"}}";
+            if (thread.dropped > 0) {
+                separator() << "{\"name\":\"dropped " << thread.dropped << " events\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":"
+                            << thread.thread_number << ",\"ts\":0}";
+            }
+
+            // Outer frames first among equal starts, then close frames as later ones begin.
+            std::sort(thread.events.begin(), thread.events.end(), [](const TimelineEvent& a, const TimelineEvent& b) {
+                return a.start_ticks != b.start_ticks ? a.start_ticks < b.start_ticks : a.end_ticks > b.end_ticks;
+            });
+            std::vector<const TimelineEvent*> open;
+            auto end_event = [&](const TimelineEvent& event) {
+                separator() << "{\"ph\":\"E\",\"pid\":1,\"tid\":" << thread.thread_number
+                            << ",\"ts\":" << microseconds(event.end_ticks) << "}";
+            };
+            for (const auto& event : thread.events) {
+                while (!open.empty() && open.back()->end_ticks <= event.start_ticks) {
+                    end_event(*open.back());
+                    open.pop_back();
+                }
+                separator() << "{\"name\":\"" << json_escape(names_[event.scope]) << "\",\"ph\":\"B\",\"pid\":1,\"tid\":"
+                            << thread.thread_number << ",\"ts\":" << microseconds(event.start_ticks) << "}";
+                open.push_back(&event);
+            }
+            while (!open.empty()) {
+                end_event(*open.back());
+                open.pop_back();
+            }
+        }
+        out << "\n]}\n";
+    }
+
+    // Every thread's tree merged by call path. The root's inclusive time is the sum of its
+    // children's.
+    CallNode call_tree() {
+        double ns_per_tick = nanoseconds_per_tick();
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<MergedNode> merged = retired_;
+        for (const ThreadTree* tree : trees_) {
+            fold(*tree, merged);
+        }
+        return convert(merged, 0, ns_per_tick);
+    }
+
+    // Zeroes every counter; tree shapes are kept. Meant for when no traced code is running.
+    void reset() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        retired_.assign(1, MergedNode{ROOT_SCOPE});
+        for (ThreadTree* tree : trees_) {
+            for (auto& node : tree->nodes) {
+                node.calls.store(0, std::memory_order_relaxed);
+                node.ticks.store(0, std::memory_order_relaxed);
+                node.allocations.store(0, std::memory_order_relaxed);
+                node.allocated_bytes.store(0, std::memory_order_relaxed);
+                for (auto& counter : node.counters) {
+                    counter.store(0, std::memory_order_relaxed);
+                }
+            }
+        }
+    }
+
+private:
+    struct ThreadEvents {
+        uint32_t thread_number;
+        uint64_t dropped;
+        std::vector<TimelineEvent> events;
+    };
+
+    static void open_timeline(ThreadTree& tree) {
+        if (!tree.event_storage) {
+            tree.event_storage = std::make_unique<TimelineEvent[]>(MAX_TIMELINE_EVENTS);
+        }
+        tree.event_count.store(0, std::memory_order_relaxed);
+        tree.dropped_events.store(0, std::memory_order_relaxed);
+        tree.events.store(tree.event_storage.get(), std::memory_order_release);
+    }
+
+    static void collect_events(const ThreadTree& tree, std::vector<ThreadEvents>& into) {
+        uint32_t count = tree.event_count.load(std::memory_order_acquire);
+        uint64_t dropped = tree.dropped_events.load(std::memory_order_relaxed);
+        if (count == 0 && dropped == 0) {
+            return;
+        }
+        const TimelineEvent* events = tree.event_storage.get();
+        into.push_back(ThreadEvents{tree.thread_number, dropped, std::vector<TimelineEvent>(events, events + count)});
+    }
+
+    static std::string json_escape(const char* text) {
+        std::string escaped;
+        for (; *text; ++text) {
+            if (*text == '"' || *text == '\\') {
+                escaped += '\\';
+            }
+            escaped += *text;
+        }
+        return escaped;
+    }
+
+    Registry() : start_ticks_(now_ticks()), start_time_(Clock::now()), retired_(1, MergedNode{ROOT_SCOPE}) {}
+
+    // Measured over the registry's lifetime (at least a millisecond), so the estimate
+    // sharpens the later a report is taken.
+    double nanoseconds_per_tick() const {
+        while (true) {
+            uint64_t ticks = now_ticks() - start_ticks_;
+            double nanoseconds = std::chrono::duration<double, std::nano>(Clock::now() - start_time_).count();
+            if (nanoseconds >= 1e6 && ticks > 0) {
+                return nanoseconds / ticks;
+            }
+        }
+    }
+
+    static size_t merged_child(std::vector<MergedNode>& merged, size_t parent, uint32_t scope) {
+        for (size_t child : merged[parent].children) {
+            if (merged[child].scope == scope) {
+                return child;
+            }
+        }
+        merged.push_back(MergedNode{scope});
+        merged[parent].children.push_back(merged.size() - 1);
+        return merged.size() - 1;
+    }
+
+    // Parents precede their children in a thread tree, so one pass maps every node.
+    static void fold(const ThreadTree& tree, std::vector<MergedNode>& merged) {
+        uint32_t count = tree.node_count.load(std::memory_order_acquire);
+        std::vector<size_t> target(count, 0);
+        merged[0].allocations += tree.nodes[0].allocations.load(std::memory_order_relaxed);
+        merged[0].allocated_bytes += tree.nodes[0].allocated_bytes.load(std::memory_order_relaxed);
+        for (uint32_t i = 1; i < count; ++i) {
+            const ThreadNode& node = tree.nodes[i];
+            target[i] = merged_child(merged, target[node.parent], node.scope);
+            merged[target[i]].calls += node.calls.load(std::memory_order_relaxed);
+            merged[target[i]].ticks += node.ticks.load(std::memory_order_relaxed);
+            merged[target[i]].allocations += node.allocations.load(std::memory_order_relaxed);
+            merged[target[i]].allocated_bytes += node.allocated_bytes.load(std::memory_order_relaxed);
+            for (int counter = 0; counter < NUM_COUNTERS; ++counter) {
+                merged[target[i]].counters[counter] += node.counters[counter].load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    CallNode convert(const std::vector<MergedNode>& merged, size_t index, double ns_per_tick) const {
+        const MergedNode& node = merged[index];
+        CallNode result;
+        result.name = node.scope == ROOT_SCOPE ? "" : names_[node.scope];
+        result.call_count = node.calls;
+        result.counters = node.counters;
+        result.allocations = result.exclusive_allocations = node.allocations;
+        result.allocated_bytes = node.allocated_bytes;
+        uint64_t children_nanoseconds = 0;
+        for (size_t child : node.children) {
+            result.children.push_back(convert(merged, child, ns_per_tick));
+            children_nanoseconds += result.children.back().inclusive_nanoseconds;
+            result.allocations += result.children.back().allocations;
+            result.allocated_bytes += result.children.back().allocated_bytes;
+            if (node.scope == ROOT_SCOPE) {
+                for (int counter = 0; counter < NUM_COUNTERS; ++counter) {
+                    result.counters[counter] += result.children.back().counters[counter];
+                }
+            }
+        }
+        result.inclusive_nanoseconds = node.scope == ROOT_SCOPE
+            ? children_nanoseconds
+            : static_cast<uint64_t>(node.ticks * ns_per_tick);
+        // A running thread's children may be read after their parent; never go negative.
+        result.exclusive_nanoseconds = result.inclusive_nanoseconds > children_nanoseconds
+            ? result.inclusive_nanoseconds - children_nanoseconds
+            : 0;
+        std::sort(result.children.begin(), result.children.end(), [](const CallNode& a, const CallNode& b) {
+            return a.inclusive_nanoseconds > b.inclusive_nanoseconds;
+        });
+        return result;
+    }
+
+    uint64_t start_ticks_;
+    Clock::time_point start_time_;
+    std::mutex mutex_;
+    std::array<const char*, MAX_SCOPES> names_{};
+    size_t scope_count_ = 0;
+    std::vector<ThreadTree*> trees_;
+    std::vector<MergedNode> retired_;
+    std::vector<ThreadEvents> retired_events_;
+    uint32_t next_thread_number_ = 0;
+    uint32_t available_counters_ = 0;
+    std::string counter_error_;
+};
+
+class ThreadState;
+
+// Set while the thread's ThreadState is fully constructed, so the allocation hook never
+// creates one (which would allocate) and never touches one being torn down.
+inline thread_local ThreadState* live_thread_state = nullptr;
+
+struct AllocationTotals {
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+};
+
+// Every allocation the calling thread made through the hook, traced or not.
+inline thread_local AllocationTotals thread_allocations;
+
+inline std::atomic<bool> allocation_hook_installed{false};
+
+// The calling thread's call tree and its position in it, attached to the registry on
+// first use.
+class ThreadState {
+public:
+    ThreadState() : tree_(std::make_unique<ThreadTree>()) {
+        active_node.fill(NO_NODE);
+        Registry::instance().attach(tree_.get());
+        live_thread_state = this;
+    }
+
+    ~ThreadState() {
+        live_thread_state = nullptr;
+        Registry::instance().detach(tree_.get());
+    }
+
+    ThreadNode& node(uint32_t index) {
+        return tree_->nodes[index];
+    }
+
+    ThreadTree& tree() {
+        return *tree_;
+    }
+
+    // Reads this thread's perf counters, opening them on first use.
+    bool read_counters(CounterValues& values) {
+        if (!perf_.opened()) {
+            perf_.open();
+            Registry::instance().note_counters(perf_);
+        }
+        return perf_.read(values);
+    }
+
+    // The node for `scope` under `parent`, created if needed; NO_NODE when the tree is full.
+    uint32_t child(uint32_t parent, uint32_t scope) {
+        ThreadNode& parent_node = tree_->nodes[parent];
+        for (uint32_t index = parent_node.first_child; index != NO_NODE; index = tree_->nodes[index].next_sibling) {
+            if (tree_->nodes[index].scope == scope) {
+                return index;
+            }
+        }
+        uint32_t index = tree_->node_count.load(std::memory_order_relaxed);
+        if (index == MAX_NODES) {
+            return NO_NODE;
+        }
+        ThreadNode& created = tree_->nodes[index];
+        created.scope = scope;
+        created.parent = parent;
+        created.next_sibling = parent_node.first_child;
+        parent_node.first_child = index;
+        tree_->node_count.store(index + 1, std::memory_order_release);
+        return index;
+    }
+
+    uint32_t current = 0;                          // Innermost active node.
+    std::array<uint32_t, MAX_SCOPES> active_node;  // Node of each scope while it is active.
+    std::array<uint32_t, MAX_SCOPES> active_depth{}; // Nested activations of each scope.
+
+private:
+    std::unique_ptr<ThreadTree> tree_;
+    PerfCounters perf_;
+};
+
+inline ThreadState& thread_state() {
+    thread_local ThreadState state;
+    return state;
+}
+
+// Called by the allocation hook for every operator new.
+inline void note_allocation(size_t bytes) {
+    ++thread_allocations.count;
+    thread_allocations.bytes += bytes;
+    if (ThreadState* state = live_thread_state) {
+        state->node(state->current).add_allocation(bytes);
+    }
 }
 
+// A traced scope's id. `name` must outlive the program (a literal or __func__).
+class Scope {
+public:
+    explicit Scope(const char* name) : id_(Registry::instance().register_scope(name)) {}
+
+    uint32_t id() const {
+        return id_;
+    }
+
+private:
+    uint32_t id_;
+};
+
 class TimeGuard {
 public:
-    TimeGuard(const std::string& function_name)
-        : name(function_name), start_time(std::chrono::high_resolution_clock::now()) {
-        get_profiles()[name].call_count++;
+    explicit TimeGuard(const Scope& scope)
+        : state_(thread_state()), scope_(scope.id()), parent_(state_.current) {
+        if (state_.active_depth[scope_]++ > 0) {
+            node_ = state_.active_node[scope_]; // Recursion: fold into the outermost frame.
+            state_.node(node_).add_call();
+            state_.current = node_;
+            return;
+        }
+        node_ = state_.child(parent_, scope_);
+        if (node_ == NO_NODE) {
+            --state_.active_depth[scope_];
+            return;
+        }
+        state_.active_node[scope_] = node_;
+        state_.current = node_;
+        if (hardware_counters_enabled.load(std::memory_order_relaxed)) {
+            counting_ = state_.read_counters(start_counters_);
+        }
+        start_ticks_ = now_ticks();
     }
 
     ~TimeGuard() {
-        auto end_time = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time);
-        get_profiles()[name].total_nanoseconds += duration.count();
+        if (node_ == NO_NODE) {
+            return;
+        }
+        state_.current = parent_;
+        if (--state_.active_depth[scope_] > 0) {
+            return;
+        }
+        uint64_t end_ticks = now_ticks();
+        ThreadNode& node = state_.node(node_);
+        node.add_ticks(end_ticks - start_ticks_);
+        node.add_call();
+        CounterValues end_counters;
+        if (counting_ && state_.read_counters(end_counters)) {
+            node.add_counters(start_counters_, end_counters);
+        }
+        if (timeline_recording.load(std::memory_order_relaxed)) {
+            state_.tree().record(scope_, start_ticks_, end_ticks);
+        }
     }
 
+    TimeGuard(const TimeGuard&) = delete;
+    TimeGuard& operator=(const TimeGuard&) = delete;
+
 private:
-    std::string name;
-    std::chrono::time_point<std::chrono::high_resolution_clock> start_time;
+    ThreadState& state_;
+    uint32_t scope_;
+    uint32_t parent_;
+    uint32_t node_ = NO_NODE;
+    uint64_t start_ticks_ = 0;
+    bool counting_ = false;
+    CounterValues start_counters_;
 };
 
+inline CallNode call_tree() {
+    return Registry::instance().call_tree();
+}
+
+// Per-name totals, sorted by name. Recursion is folded in the tree, so nodes of one name
+// never nest and their inclusive times add up without double counting.
+inline std::vector<FunctionProfile> snapshot() {
+    CallNode root = call_tree();
+    std::map<std::string, FunctionProfile> by_name;
+    std::vector<const CallNode*> pending;
+    for (const auto& child : root.children) {
+        pending.push_back(&child);
+    }
+    while (!pending.empty()) {
+        const CallNode* node = pending.back();
+        pending.pop_back();
+        FunctionProfile& profile = by_name[node->name];
+        profile.name = node->name;
+        profile.call_count += node->call_count;
+        profile.total_nanoseconds += node->inclusive_nanoseconds;
+        profile.exclusive_nanoseconds += node->exclusive_nanoseconds;
+        profile.allocations += node->allocations;
+        profile.allocated_bytes += node->allocated_bytes;
+        profile.exclusive_allocations += node->exclusive_allocations;
+        for (int counter = 0; counter < NUM_COUNTERS; ++counter) {
+            profile.counters[counter] += node->counters[counter];
+        }
+        for (const auto& child : node->children) {
+            pending.push_back(&child);
+        }
+    }
+
+    std::vector<FunctionProfile> profiles;
+    for (auto& entry : by_name) {
+        profiles.push_back(std::move(entry.second));
+    }
+    return profiles;
+}
+
+inline void reset() {
+    Registry::instance().reset();
+}
+
+// Starts reading perf counters around every timed frame. Returns false (and tracing goes
+// on with times only) when no counter can be opened, e.g. without a PMU or when
+// perf_event_paranoid or a container's seccomp profile forbids it.
+inline bool enable_hardware_counters() {
+    hardware_counters_enabled.store(true, std::memory_order_relaxed);
+    CounterValues probe;
+    return thread_state().read_counters(probe);
+}
+
+inline void disable_hardware_counters() {
+    hardware_counters_enabled.store(false, std::memory_order_relaxed);
+}
+
+// Bit c is set if counter c opened on at least one thread.
+inline uint32_t available_counters() {
+    return Registry::instance().available_counters();
+}
+
+inline void start_timeline() {
+    Registry::instance().start_timeline();
+}
+
+inline void stop_timeline() {
+    Registry::instance().stop_timeline();
+}
+
+inline void write_chrome_trace(std::ostream& out) {
+    Registry::instance().write_chrome_trace(out);
+}
+
+inline void write_folded_stacks(const CallNode& node, const std::string& path, std::ostream& out) {
+    std::string name = node.name;
+    std::replace(name.begin(), name.end(), ';', ':');
+    std::string stack = path.empty() ? name : path + ";" + name;
+    if (node.exclusive_nanoseconds > 0) {
+        out << stack << ' ' << node.exclusive_nanoseconds << '\n';
+    }
+    for (const auto& child : node.children) {
+        write_folded_stacks(child, stack, out);
+    }
+}
+
+// One "caller;callee;... <exclusive ns>" line per call path, for flamegraph.pl,
+// inferno or speedscope.
+inline void write_folded_stacks(std::ostream& out) {
+    CallNode root = call_tree();
+    for (const auto& child : root.children) {
+        write_folded_stacks(child, "", out);
+    }
+}
+
+inline void print_call_tree(const CallNode& node, uint64_t parent_nanoseconds, int depth) {
+    double percent = parent_nanoseconds ? 100.0 * node.inclusive_nanoseconds / parent_nanoseconds : 100.0;
+    std::cout << std::left << std::setw(60) << (std::string(2 * depth, ' ') + node.name)
+              << std::right << std::setw(12) << node.call_count
+              << std::setw(20) << node.inclusive_nanoseconds
+              << std::setw(20) << node.exclusive_nanoseconds
+              << std::setw(9) << std::fixed << std::setprecision(1) << percent << "%" << std::endl;
+    for (const auto& child : node.children) {
+        print_call_tree(child, node.inclusive_nanoseconds, depth + 1);
+    }
+}
+
+inline void print_counter_report() {
+    uint32_t available = available_counters();
+    std::cout << "\n--- Hardware Counters (inclusive) ---" << std::endl;
+    if (available == 0) {
+        std::string error = Registry::instance().counter_error();
+        std::cout << "Unavailable" << (error.empty() ? "" : " (" + error + ")") << std::endl;
+        return;
+    }
+    std::cout << std::left << std::setw(50) << "Function" << std::right;
+    for (int counter = 0; counter < NUM_COUNTERS; ++counter) {
+        std::cout << std::setw(18) << counter_name(counter);
+    }
+    std::cout << std::setw(8) << "IPC" << std::endl;
+    std::cout << std::string(50 + 18 * NUM_COUNTERS + 8, '-') << std::endl;
+
+    for (const auto& profile : snapshot()) {
+        std::cout << std::left << std::setw(50) << profile.name << std::right;
+        for (int counter = 0; counter < NUM_COUNTERS; ++counter) {
+            if (available & (1u << counter)) {
+                std::cout << std::setw(18) << profile.counters[counter];
+            } else {
+                std::cout << std::setw(18) << "n/a";
+            }
+        }
+        uint32_t ipc_counters = (1u << CYCLES) | (1u << INSTRUCTIONS);
+        if ((available & ipc_counters) == ipc_counters && profile.counters[CYCLES] > 0) {
+            std::cout << std::setw(8) << std::fixed << std::setprecision(2)
+                      << static_cast<double>(profile.counters[INSTRUCTIONS]) / profile.counters[CYCLES];
+        } else {
+            std::cout << std::setw(8) << "n/a";
+        }
+        std::cout << std::endl;
+    }
+}
+
+inline void print_allocation_report() {
+    std::cout << "\n--- Heap Allocations (inclusive) ---" << std::endl;
+    std::cout << std::left << std::setw(50) << "Function"
+              << std::right << std::setw(15) << "Allocations"
+              << std::setw(18) << "Bytes"
+              << std::setw(15) << "Allocs/Call"
+              << std::setw(15) << "Bytes/Call"
+              << std::setw(18) << "Exclusive Allocs" << std::endl;
+    std::cout << std::string(131, '-') << std::endl;
+
+    for (const auto& profile : snapshot()) {
+        double calls = profile.call_count ? static_cast<double>(profile.call_count) : 1.0;
+        std::cout << std::left << std::setw(50) << profile.name
+                  << std::right << std::setw(15) << profile.allocations
+                  << std::setw(18) << profile.allocated_bytes
+                  << std::setw(15) << std::fixed << std::setprecision(2) << profile.allocations / calls
+                  << std::setw(15) << std::setprecision(1) << profile.allocated_bytes / calls
+                  << std::setw(18) << profile.exclusive_allocations << std::endl;
+    }
+    std::cout << std::left << std::setw(50) << "(outside traced scopes)"
+              << std::right << std::setw(15) << call_tree().exclusive_allocations << std::endl;
+}
+
 inline void print_performance_report() {
     std::cout << "\n--- Performance Report ---" << std::endl;
     std::cout << std::left << std::setw(50) << "Function"
               << std::right << std::setw(15) << "Call Count"
               << std::setw(25) << "Total Time (ns)"
+              << std::setw(25) << "Exclusive Time (ns)"
               << std::setw(25) << "Avg Time/Call (ns)" << std::endl;
-    std::cout << std::string(115, '-') << std::endl;
+    std::cout << std::string(140, '-') << std::endl;
 
-    for (const auto& pair : get_profiles()) {
-        const std::string& name = pair.first;
-        const FunctionProfile& profile = pair.second;
+    for (const auto& profile : snapshot()) {
         long double avg_time_per_call = 0;
         if (profile.call_count > 0) {
             avg_time_per_call = static_cast<long double>(profile.total_nanoseconds) / profile.call_count;
         }
 
-        std::cout << std::left << std::setw(50) << name
+        std::cout << std::left << std::setw(50) << profile.name
                   << std::right << std::setw(15) << profile.call_count
                   << std::setw(25) << profile.total_nanoseconds
+                  << std::setw(25) << profile.exclusive_nanoseconds
                   << std::setw(25) << std::fixed << std::setprecision(2) << avg_time_per_call
                   << std::endl;
     }
+
+    if (hardware_counters_enabled.load(std::memory_order_relaxed)) {
+        print_counter_report();
+    }
+    if (allocation_hook_installed.load(std::memory_order_relaxed)) {
+        print_allocation_report();
+    }
+
+    std::cout << "\n--- Call Tree (inclusive / exclusive ns, share of parent) ---" << std::endl;
+    std::cout << std::left << std::setw(60) << "Scope"
+              << std::right << std::setw(12) << "Calls"
+              << std::setw(20) << "Inclusive (ns)"
+              << std::setw(20) << "Exclusive (ns)"
+              << std::setw(10) << "Parent" << std::endl;
+    std::cout << std::string(122, '-') << std::endl;
+    CallNode root = call_tree();
+    for (const auto& child : root.children) {
+        print_call_tree(child, root.inclusive_nanoseconds, 0);
+    }
     std::cout << "--------------------------" << std::endl;
 }
 
-// Macro to create a TimeGuard object easily
-#define TRACE_FUNCTION() PerformanceTracer::TimeGuard time_guard_obj(__func__) // __func__ gives the current function name
-
 } // namespace PerformanceTracer
 
-#else // ENABLE_PERFORMANCE_TRACING is not defined
+#define PERFORMANCE_TRACER_CONCAT_(a, b) a##b
+#define PERFORMANCE_TRACER_CONCAT(a, b) PERFORMANCE_TRACER_CONCAT_(a, b)
 
-// Define macros as no-ops if tracing is disabled
-#define TRACE_FUNCTION()
-namespace PerformanceTracer {
-    inline void print_performance_report() {
-        // Do nothing if tracing is disabled
-        // std::cout << "\nPerformance tracing was disabled at compile time." << std::endl;
-    }
-} // namespace PerformanceTracer
+// Times the rest of the enclosing block under `name`, which must be a string literal (or
+// __func__). TRACE_FUNCTION() traces the enclosing function under its own name.
+#define TRACE_SCOPE_ALWAYS(name) \
+    static const PerformanceTracer::Scope PERFORMANCE_TRACER_CONCAT(trace_scope_, __LINE__)(name); \
+    PerformanceTracer::TimeGuard PERFORMANCE_TRACER_CONCAT(trace_guard_, __LINE__)(PERFORMANCE_TRACER_CONCAT(trace_scope_, __LINE__))
+
+#ifdef ENABLE_PERFORMANCE_TRACING
+#define TRACE_SCOPE(name) TRACE_SCOPE_ALWAYS(name)
+#else
+#define TRACE_SCOPE(name)
+#endif
 
-#endif // ENABLE_PERFORMANCE_TRACING
+#define TRACE_FUNCTION() TRACE_SCOPE(__func__)
@@ -1,188 +1,247 @@
 #pragma once
 
 #include <vector>
-#include <algorithm> // For sort, next_permutation
-#include <map>       // For grouping by color in findRuns
-#include <set>       // To avoid duplicate sets if any
+#include <array>
+#include <cstdint>
 #include "GameTypes.hpp" // For GameSet, SetType, and it pulls in Tile.hpp, runs.hpp, groups.hpp
 #include "PerformanceTracer.hpp" // For performance tracing
 
 // Note: runs.hpp, groups.hpp, Tile.hpp are already included by GameTypes.hpp.
-// Explicitly including them here is redundant but harmless due to include guards.
-// For cleanliness, they are removed as GameTypes.hpp is the primary source for these types now.
-
-// --- Forward declarations or include completed versions ---
-// Assuming findRuns and findGroups will be refactored or new versions created.
 
 namespace SetFinder {
 
-// Helper function to generate all subsets of a specific size (combinations)
-// From a vector of tiles. Used for finding groups.
-std::vector<std::vector<Tile>> getCombinations(const std::vector<Tile>& tiles, int k) {
-    std::vector<std::vector<Tile>> combinations;
-    if (k < 0 || k > tiles.size()) {
-        return combinations;
-    }
-    std::vector<bool> v(tiles.size());
-    std::fill(v.begin() + v.size() - k, v.end(), true);
-
-    do {
-        std::vector<Tile> current_combination;
-        for (int i = 0; i < tiles.size(); ++i) {
-            if (v[i]) {
-                current_combination.push_back(tiles[i]);
-            }
+using TileCode::KindMask;
+
+// --- Compile-time catalog of every legal set ---
+// With 4 colors x 13 numbers there are only 66 runs per color (lengths 3..13) and
+// 5 groups per number (four 3-color groups plus the 4-color group). Each entry is a
+// bitmask over tile kinds, so "can this set be formed from the pool" is one AND.
+constexpr int RUNS_PER_COLOR = (TileCode::NUM_NUMBERS - 1) * (TileCode::NUM_NUMBERS - 2) / 2;
+constexpr int NUM_CATALOG_RUNS = TileCode::NUM_COLORS * RUNS_PER_COLOR;
+constexpr int NUM_CATALOG_GROUPS = TileCode::NUM_NUMBERS * (TileCode::NUM_COLORS + 1);
+constexpr int CATALOG_SIZE = NUM_CATALOG_RUNS + NUM_CATALOG_GROUPS;
+
+struct CatalogEntry {
+    KindMask mask;
+    SetType type;
+    uint8_t size;
+};
+
+// Lexicographic comparison of the ascending kind sequences encoded by two masks.
+// Matches GameSet::operator< on sets built from copy-0 tiles.
+constexpr bool kind_sequence_less(KindMask a, KindMask b) {
+    while (a != 0 && b != 0) {
+        KindMask low_a = a & (~a + 1);
+        KindMask low_b = b & (~b + 1);
+        if (low_a != low_b) {
+            return low_a < low_b;
         }
-        // Sorting here ensures that {T1,T2,T3} is the same as {T3,T1,T2} if GameSet sorts internally
-        // However, GameSet constructor already sorts, so this might be redundant if GameSet is used directly.
-        // For now, let's keep it to be safe for intermediate std::vector<Tile>
-        std::sort(current_combination.begin(), current_combination.end());
-        combinations.push_back(current_combination);
-    } while (std::next_permutation(v.begin(), v.end()));
-    return combinations;
+        a ^= low_a;
+        b ^= low_b;
+    }
+    return a == 0 && b != 0;
 }
 
+constexpr bool catalog_entry_less(const CatalogEntry& a, const CatalogEntry& b) {
+    if (a.type != b.type) {
+        return static_cast<int>(a.type) < static_cast<int>(b.type);
+    }
+    return kind_sequence_less(a.mask, b.mask);
+}
+
+constexpr std::array<CatalogEntry, CATALOG_SIZE> make_catalog() {
+    std::array<CatalogEntry, CATALOG_SIZE> catalog{};
+    int n = 0;
 
-// --- Refactored or New findRuns ---
-// This function should find all possible valid runs of length 3 or more.
-std::vector<GameSet> findAllValidRuns(std::vector<Tile> tiles) {
-    std::vector<GameSet> valid_runs;
-    if (tiles.size() < 3) {
-        return valid_runs;
+    for (int c = 1; c <= TileCode::NUM_COLORS; ++c) {
+        for (int start = 1; start <= TileCode::NUM_NUMBERS - 2; ++start) {
+            for (int end = start + 2; end <= TileCode::NUM_NUMBERS; ++end) {
+                KindMask mask = 0;
+                for (int number = start; number <= end; ++number) {
+                    mask |= TileCode::kindBit(TileCode::kindOf(number, c));
+                }
+                catalog[n++] = {mask, SetType::RUN, static_cast<uint8_t>(end - start + 1)};
+            }
+        }
     }
 
-    // Sort by color, then by number for easier processing of runs
-    std::sort(tiles.begin(), tiles.end());
+    for (int number = 1; number <= TileCode::NUM_NUMBERS; ++number) {
+        KindMask all_colors = 0;
+        for (int c = 1; c <= TileCode::NUM_COLORS; ++c) {
+            all_colors |= TileCode::kindBit(TileCode::kindOf(number, c));
+        }
+        catalog[n++] = {all_colors, SetType::GROUP, static_cast<uint8_t>(TileCode::NUM_COLORS)};
+        for (int skipped = 1; skipped <= TileCode::NUM_COLORS; ++skipped) {
+            KindMask mask = all_colors & ~TileCode::kindBit(TileCode::kindOf(number, skipped));
+            catalog[n++] = {mask, SetType::GROUP, static_cast<uint8_t>(TileCode::NUM_COLORS - 1)};
+        }
+    }
 
-    // Group tiles by color
-    std::map<int, std::vector<Tile>> tiles_by_color;
-    for (const auto& tile : tiles) {
-        tiles_by_color[tile.getColor()].push_back(tile);
+    // Keep the catalog in GameSet order so filtered results need no sorting.
+    for (int i = 1; i < CATALOG_SIZE; ++i) {
+        CatalogEntry entry = catalog[i];
+        int j = i - 1;
+        while (j >= 0 && catalog_entry_less(entry, catalog[j])) {
+            catalog[j + 1] = catalog[j];
+            --j;
+        }
+        catalog[j + 1] = entry;
     }
 
-    for (const auto& pair_color_tiles : tiles_by_color) {
-        // const int color_val = pair_color_tiles.first; // If needed
-        const std::vector<Tile>& colored_tiles = pair_color_tiles.second;
-        if (colored_tiles.size() < 3) {
-            continue;
+    return catalog;
+}
+
+inline constexpr std::array<CatalogEntry, CATALOG_SIZE> CATALOG = make_catalog();
+
+static_assert(CATALOG_SIZE == 329, "4 colors x 13 numbers give 264 runs and 65 groups");
+
+// --- Inverted index: tile kind -> catalog sets containing it ---
+// A search that must place a given tile only needs the sets through its kind: 4 groups
+// and 11 (for a 1 or 13) to 46 (for a 7) runs, against 329 sets in all.
+// The sets of kind k are KIND_INDEX.sets[offsets[k] .. offsets[k + 1]), in GameSet order.
+constexpr int count_catalog_memberships() {
+    int total = 0;
+    for (const auto& entry : CATALOG) {
+        total += entry.size;
+    }
+    return total;
+}
+
+constexpr int NUM_CATALOG_MEMBERSHIPS = count_catalog_memberships();
+
+struct KindIndex {
+    std::array<uint16_t, TileCode::NUM_KINDS + 1> offsets;
+    std::array<uint16_t, NUM_CATALOG_MEMBERSHIPS> sets;
+};
+
+constexpr KindIndex make_kind_index() {
+    KindIndex index{};
+    for (const auto& entry : CATALOG) {
+        for (KindMask rest = entry.mask; rest != 0; rest &= rest - 1) {
+            ++index.offsets[__builtin_ctzll(rest) + 1];
         }
-        // For each color, find all contiguous runs
-        // Example: R1 R2 R3 R4 R5 -> R1R2R3, R1R2R3R4, R1R2R3R4R5, R2R3R4, R2R3R4R5, R3R4R5
-        for (size_t i = 0; i < colored_tiles.size(); ++i) {
-            for (size_t j = i; j < colored_tiles.size(); ++j) {
-                // Potential run is from colored_tiles[i] to colored_tiles[j]
-                if (j - i + 1 >= 3) { // Minimum length of a run is 3
-                    std::vector<Tile> potential_run_segment;
-                    bool is_contiguous = true;
-                    potential_run_segment.push_back(colored_tiles[i]);
-                    for (size_t k = i + 1; k <= j; ++k) {
-                        if (colored_tiles[k].getNumber() == colored_tiles[k-1].getNumber() + 1) {
-                            potential_run_segment.push_back(colored_tiles[k]);
-                        } else {
-                            is_contiguous = false;
-                            break;
-                        }
-                    }
-
-                    if (is_contiguous && potential_run_segment.size() >= 3) {
-                        GameSet run_set(potential_run_segment, SetType::RUN);
-                        // isValidRun will be called by GameSet constructor's isValid implicitly
-                        // or we can rely on the GameSet::isValid() method.
-                        // The construction logic itself here should ensure it's a valid run.
-                        if (run_set.isValid()) { // Double check, though logic should ensure it
-                           valid_runs.push_back(run_set);
-                        }
-                    }
-                }
-            }
+    }
+    for (int kind = 0; kind < TileCode::NUM_KINDS; ++kind) {
+        index.offsets[kind + 1] += index.offsets[kind];
+    }
+    std::array<uint16_t, TileCode::NUM_KINDS> filled{};
+    for (int i = 0; i < CATALOG_SIZE; ++i) {
+        for (KindMask rest = CATALOG[i].mask; rest != 0; rest &= rest - 1) {
+            int kind = __builtin_ctzll(rest);
+            index.sets[index.offsets[kind] + filled[kind]++] = static_cast<uint16_t>(i);
         }
     }
-    // Remove duplicate GameSets if any (e.g. if input tiles had duplicates that formed identical runs)
-    // Sorting and unique works if GameSet has operator< and operator==
-    // Remove duplicate GameSets. GameSet::operator< and GameSet::operator== are now defined.
-    std::sort(valid_runs.begin(), valid_runs.end());
-    valid_runs.erase(std::unique(valid_runs.begin(), valid_runs.end()), valid_runs.end());
-    return valid_runs;
+    return index;
 }
 
+inline constexpr KindIndex KIND_INDEX = make_kind_index();
+
+// CATALOG indices, as returned by sets_containing.
+struct CatalogRange {
+    const uint16_t* first;
+    const uint16_t* last;
 
-// --- Completed findGroups ---
-std::vector<GameSet> findAllValidGroups(std::vector<Tile> tiles) {
-    std::vector<GameSet> valid_groups;
-    if (tiles.size() < 3) {
-        return valid_groups;
+    const uint16_t* begin() const { return first; }
+    const uint16_t* end() const { return last; }
+    size_t size() const { return static_cast<size_t>(last - first); }
+    bool empty() const { return first == last; }
+};
+
+// The catalog sets containing a tile kind, in GameSet order; empty for a kind outside the
+// four colors (or a joker), which no catalog set holds.
+inline CatalogRange sets_containing(int kind) {
+    if (!TileCode::isPlayableKind(kind)) {
+        return {nullptr, nullptr};
     }
+    const uint16_t* sets = KIND_INDEX.sets.data();
+    return {sets + KIND_INDEX.offsets[kind], sets + KIND_INDEX.offsets[kind + 1]};
+}
 
-    std::unordered_map<int, std::vector<Tile>> tiles_by_number;
+// Kinds present in a collection of tiles. Copies and non-playable tiles collapse away.
+template <typename Tiles = std::vector<Tile>>
+inline KindMask pool_mask(const Tiles& tiles) {
+    KindMask mask = 0;
     for (const auto& tile : tiles) {
-        tiles_by_number[tile.getNumber()].push_back(tile);
+        mask |= TileCode::kindBit(tile.getKind());
     }
+    return mask;
+}
 
-    for (const auto& pair_number_tiles : tiles_by_number) {
-        // const int number = pair_number_tiles.first; // If needed
-        const std::vector<Tile>& same_number_tiles = pair_number_tiles.second;
-        if (same_number_tiles.size() < 3) {
-            continue;
-        }
+inline bool can_form(const CatalogEntry& entry, KindMask pool) {
+    return (entry.mask & ~pool) == 0;
+}
 
-        // Try combinations of 3 tiles
-        if (same_number_tiles.size() >= 3) {
-            std::vector<std::vector<Tile>> combinations_of_3 = getCombinations(same_number_tiles, 3);
-            for (const auto& combo : combinations_of_3) {
-                GameSet group_set(combo, SetType::GROUP);
-                if (group_set.isValid()) {
-                    valid_groups.push_back(group_set);
-                }
-            }
+// Walks the copy-0 tiles of the kinds in a mask, in ascending code order.
+class MaskTileIterator {
+public:
+    explicit MaskTileIterator(KindMask rest) : rest_(rest) {}
+
+    Tile operator*() const {
+        return Tile::fromCode(static_cast<uint8_t>(__builtin_ctzll(rest_) << 1));
+    }
+
+    MaskTileIterator& operator++() {
+        rest_ &= rest_ - 1;
+        return *this;
+    }
+
+    bool operator!=(const MaskTileIterator& other) const {
+        return rest_ != other.rest_;
+    }
+
+private:
+    KindMask rest_;
+};
+
+// Expands a catalog entry into a GameSet of copy-0 tiles (a kind template).
+inline GameSet to_game_set(const CatalogEntry& entry) {
+    return GameSet(MaskTileIterator(entry.mask), MaskTileIterator(0), entry.type);
+}
+
+// Indices into CATALOG of every set that can be formed from the given kinds, in GameSet order.
+inline std::vector<int> find_all_possible_set_indices(KindMask pool) {
+    std::vector<int> indices;
+    for (int i = 0; i < CATALOG_SIZE; ++i) {
+        if (can_form(CATALOG[i], pool)) {
+            indices.push_back(i);
         }
+    }
+    return indices;
+}
 
-        // Try combinations of 4 tiles
-        if (same_number_tiles.size() >= 4) {
-            std::vector<std::vector<Tile>> combinations_of_4 = getCombinations(same_number_tiles, 4);
-            for (const auto& combo : combinations_of_4) {
-                GameSet group_set(combo, SetType::GROUP);
-                if (group_set.isValid()) {
-                    valid_groups.push_back(group_set);
-                }
-            }
+inline std::vector<GameSet> filter_catalog(KindMask pool, SetType type) {
+    std::vector<GameSet> sets;
+    for (const auto& entry : CATALOG) {
+        if (entry.type == type && can_form(entry, pool)) {
+            sets.push_back(to_game_set(entry));
         }
     }
-     // To ensure uniqueness if GameSet has operator< and operator==
-    // std::sort(valid_groups.begin(), valid_groups.end());
-    // valid_groups.erase(std::unique(valid_groups.begin(), valid_groups.end()), valid_groups.end());
-    // A std::set<GameSet> is better for uniqueness. For now, we might get duplicates if the input
-    // tiles can form the same group in multiple ways (e.g. if input has R1,B1,Y1,P1,R1_dup,B1_dup).
-    // GameSet sorts its internal tiles, so {R1,B1,Y1} is same as {B1,Y1,R1}.
-    // If `valid_groups` is a std::vector<GameSet>, we need to sort and unique.
-    // If it's a std::set<GameSet>, it handles uniqueness if GameSet::operator< is defined.
-    // Let's use std::set temporarily to handle uniqueness, then convert to vector.
-    // Requires GameSet::operator<
-    // Remove duplicate GameSets. GameSet::operator< and GameSet::operator== are now defined.
-    std::sort(valid_groups.begin(), valid_groups.end());
-    valid_groups.erase(std::unique(valid_groups.begin(), valid_groups.end()), valid_groups.end());
-    return valid_groups;
+    return sets;
 }
 
+// All valid runs (length 3 or more) that can be formed from the given tiles.
+inline std::vector<GameSet> findAllValidRuns(const std::vector<Tile>& tiles) {
+    return filter_catalog(pool_mask(tiles), SetType::RUN);
+}
+
+// All valid groups (3 or 4 distinct colors of one number) that can be formed from the given tiles.
+inline std::vector<GameSet> findAllValidGroups(const std::vector<Tile>& tiles) {
+    return filter_catalog(pool_mask(tiles), SetType::GROUP);
+}
 
 // --- Main function for this step ---
-// Changed sub-function params to take const& and copy internally if modification is needed.
-// However, findRuns/findGroups already take by value, which makes a copy.
-// So, find_all_possible_sets can just pass its const& argument.
-std::vector<GameSet> find_all_possible_sets(const std::vector<Tile>& input_tiles) {
+// Every set in the catalog whose kinds are all present in input_tiles, sorted and unique.
+// Sets are templates over tile kinds (copy-0 tiles); the search picks the actual copies.
+inline std::vector<GameSet> find_all_possible_sets(const std::vector<Tile>& input_tiles) {
     TRACE_FUNCTION();
+    KindMask pool = pool_mask(input_tiles);
     std::vector<GameSet> all_sets;
 
-    // Pass input_tiles (const ref). The by-value parameters in the helper functions
-    // will create copies for them to work with.
-    std::vector<GameSet> runs = findAllValidRuns(input_tiles);
-    all_sets.insert(all_sets.end(), runs.begin(), runs.end());
-
-    std::vector<GameSet> groups = findAllValidGroups(input_tiles);
-    all_sets.insert(all_sets.end(), groups.begin(), groups.end());
-
-    // Consolidate all found sets and remove duplicates
-    std::sort(all_sets.begin(), all_sets.end());
-    all_sets.erase(std::unique(all_sets.begin(), all_sets.end()), all_sets.end());
+    for (const auto& entry : CATALOG) {
+        if (can_form(entry, pool)) {
+            all_sets.push_back(to_game_set(entry));
+        }
+    }
 
     return all_sets;
 }
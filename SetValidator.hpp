@@ -0,0 +1,253 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <algorithm>       // For std::min
+#include <memory_resource> // For arena-backed batches
+
+#include "Tile.hpp"
+
+enum class SetType : uint8_t {
+    RUN,
+    GROUP
+};
+
+// Branch-free validity checks for runs and groups over a compact encoding.
+//
+// A set is encoded as the mask of its numbered tile kinds plus its size and joker count.
+// The rules then reduce to word operations:
+//   - every numbered tile is a distinct playable kind: popcount(kinds) == size - jokers;
+//   - a run stays in one color row, and its numbers span no more than `size` values, so
+//     the jokers can fill the gaps (leftover jokers extend the run, and 3..13 tiles
+//     always fit in 1..13);
+//   - a group uses one number, and distinct kinds of one number are distinct colors.
+// Tiles outside the four colors have no kind bit, so any set holding one is invalid.
+//
+// Batch keeps many encoded sets as parallel arrays, and validate() checks them all at once
+// into a bitmap. The kernel is straight-line arithmetic on 64-bit lanes, which the
+// compiler vectorizes (with AVX-512 it has a vector popcount).
+namespace SetValidator {
+
+using TileCode::KindMask;
+
+constexpr int MIN_SET_SIZE = 3;
+constexpr int MAX_GROUP_SIZE = TileCode::NUM_COLORS;
+constexpr int MAX_RUN_SIZE = TileCode::NUM_NUMBERS;
+constexpr KindMask ROW_MASK = (KindMask(1) << TileCode::NUM_NUMBERS) - 1; // One color's kinds.
+
+struct SetCode {
+    KindMask kinds = 0;         // Kinds of the numbered tiles.
+    KindMask second_copies = 0; // The kinds whose tile in this set is copy 1.
+    uint8_t size = 0;           // All tiles, jokers included.
+    uint8_t jokers = 0;
+    uint8_t joker_copies = 0;   // Bit c set if joker copy c is in the set.
+    SetType type = SetType::RUN;
+};
+
+// What one tile code adds to a SetCode.
+struct TileBits {
+    KindMask kind = 0;
+    KindMask second_copy = 0;
+    uint8_t joker = 0;
+    uint8_t joker_copy = 0;
+};
+
+constexpr std::array<TileBits, TileCode::NUM_CODES> make_tile_bits() {
+    std::array<TileBits, TileCode::NUM_CODES> table{};
+    for (int code = 0; code < TileCode::NUM_CODES; ++code) {
+        int kind = TileCode::kind(static_cast<uint8_t>(code));
+        int copy = TileCode::copy(static_cast<uint8_t>(code));
+        table[code].kind = TileCode::kindBit(kind);
+        table[code].second_copy = copy ? TileCode::kindBit(kind) : 0;
+        table[code].joker = TileCode::isJokerKind(kind);
+        table[code].joker_copy = static_cast<uint8_t>(table[code].joker << copy);
+    }
+    return table;
+}
+
+inline constexpr std::array<TileBits, TileCode::NUM_CODES> TILE_BITS = make_tile_bits();
+
+template <typename Tiles>
+inline SetCode encode(const Tiles& tiles, SetType type) {
+    SetCode code;
+    code.type = type;
+    size_t size = 0;
+    for (const auto& tile : tiles) {
+        const TileBits& bits = TILE_BITS[tile.getCode()];
+        code.kinds |= bits.kind;
+        code.second_copies |= bits.second_copy;
+        code.jokers += bits.joker;
+        code.joker_copies |= bits.joker_copy;
+        ++size;
+    }
+    // Anything longer than a run can be is invalid; clamping keeps that true in a byte.
+    code.size = static_cast<uint8_t>(size > MAX_RUN_SIZE ? MAX_RUN_SIZE + 1 : size);
+    return code;
+}
+
+// The rules above for one set; `run` (0 or 1) selects the run rule. Every operand is a
+// 64-bit lane so the batch loops vectorize.
+inline uint64_t valid_lane(KindMask kinds, uint64_t size, uint64_t jokers, uint64_t run) {
+    KindMask r0 = kinds & ROW_MASK;
+    KindMask r1 = (kinds >> TileCode::NUM_NUMBERS) & ROW_MASK;
+    KindMask r2 = (kinds >> (2 * TileCode::NUM_NUMBERS)) & ROW_MASK;
+    KindMask r3 = (kinds >> (3 * TileCode::NUM_NUMBERS)) & ROW_MASK;
+    KindMask numbers = r0 | r1 | r2 | r3;
+    uint64_t rows = (r0 != 0) + (r1 != 0) + (r2 != 0) + (r3 != 0);
+
+    // Span of the numbers: every bit from the lowest to the highest.
+    KindMask below_high = numbers;
+    below_high |= below_high >> 1;
+    below_high |= below_high >> 2;
+    below_high |= below_high >> 4;
+    below_high |= below_high >> 8;
+    KindMask span = below_high & ~((numbers & (~numbers + 1)) - 1);
+
+    uint64_t distinct = static_cast<uint64_t>(__builtin_popcountll(kinds)) + jokers == size;
+    uint64_t run_ok = (size <= MAX_RUN_SIZE) & (rows <= 1) &
+                      (static_cast<uint64_t>(__builtin_popcountll(span)) <= size);
+    uint64_t group_ok = (size <= MAX_GROUP_SIZE) & (__builtin_popcountll(numbers) <= 1);
+    return distinct & (size >= MIN_SET_SIZE) & ((run & run_ok) | (~run & group_ok));
+}
+
+inline bool is_valid(const SetCode& code) {
+    return valid_lane(code.kinds, code.size, code.jokers, code.type == SetType::RUN) != 0;
+}
+
+// Physical tiles seen so far, for checking that sets share none.
+class TileUse {
+public:
+    // Marks the set's tiles as used; false if one of them already was. Also false if the
+    // set holds the same joker twice (repeated numbered tiles make the set invalid anyway).
+    bool add(KindMask kinds, KindMask second_copies, uint8_t jokers, uint8_t joker_copies) {
+        KindMask second = kinds & second_copies;
+        KindMask first = kinds & ~second_copies;
+        bool fresh = ((first_ & first) | (second_ & second)) == 0 && (jokers_ & joker_copies) == 0 &&
+                     __builtin_popcount(joker_copies) == jokers;
+        first_ |= first;
+        second_ |= second;
+        jokers_ |= joker_copies;
+        return fresh;
+    }
+
+    bool add(const SetCode& code) {
+        return add(code.kinds, code.second_copies, code.jokers, code.joker_copies);
+    }
+
+private:
+    KindMask first_ = 0;
+    KindMask second_ = 0;
+    uint8_t jokers_ = 0;
+};
+
+// Encoded sets as parallel arrays. Pass a memory resource (an Arena scope) to keep a
+// short-lived batch off the heap.
+class Batch {
+public:
+    explicit Batch(std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+        : kinds_(memory), second_copies_(memory), sizes_(memory), jokers_(memory),
+          joker_copies_(memory), runs_(memory) {}
+
+    void reserve(size_t count) {
+        kinds_.reserve(count);
+        second_copies_.reserve(count);
+        sizes_.reserve(count);
+        jokers_.reserve(count);
+        joker_copies_.reserve(count);
+        runs_.reserve(count);
+    }
+
+    void add(const SetCode& code) {
+        kinds_.push_back(code.kinds);
+        second_copies_.push_back(code.second_copies);
+        sizes_.push_back(code.size);
+        jokers_.push_back(code.jokers);
+        joker_copies_.push_back(code.joker_copies);
+        runs_.push_back(code.type == SetType::RUN);
+    }
+
+    template <typename Tiles>
+    void add(const Tiles& tiles, SetType type) {
+        add(encode(tiles, type));
+    }
+
+    void clear() {
+        kinds_.clear();
+        second_copies_.clear();
+        sizes_.clear();
+        jokers_.clear();
+        joker_copies_.clear();
+        runs_.clear();
+    }
+
+    size_t size() const {
+        return kinds_.size();
+    }
+
+    // Bit i % 64 of bitmap[i / 64] is set if set i is valid. The bitmap needs
+    // (size() + 63) / 64 words; bits past size() are left clear.
+    void validate(uint64_t* bitmap) const {
+        for (size_t begin = 0; begin < size(); begin += 64) {
+            bitmap[begin / 64] = validate_word(begin, std::min<size_t>(64, size() - begin));
+        }
+    }
+
+    std::vector<uint64_t> validate() const {
+        std::vector<uint64_t> bitmap((size() + 63) / 64);
+        validate(bitmap.data());
+        return bitmap;
+    }
+
+    // True if every set is valid.
+    bool all_valid() const {
+        for (size_t begin = 0; begin < size(); begin += 64) {
+            size_t lanes = std::min<size_t>(64, size() - begin);
+            uint64_t all = lanes == 64 ? ~uint64_t(0) : (uint64_t(1) << lanes) - 1;
+            if (validate_word(begin, lanes) != all) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // True if no physical tile (the same kind and copy, or the same joker) appears in two
+    // sets. A numbered tile repeated within one set already makes that set invalid.
+    bool tiles_distinct() const {
+        TileUse seen;
+        bool distinct = true;
+        for (size_t i = 0; i < size(); ++i) {
+            distinct &= seen.add(kinds_[i], second_copies_[i], jokers_[i], joker_copies_[i]);
+        }
+        return distinct;
+    }
+
+private:
+    // Validity bits of sets begin .. begin + lanes - 1 (lanes <= 64).
+    uint64_t validate_word(size_t begin, size_t lanes) const {
+        const KindMask* kinds = kinds_.data() + begin;
+        const uint8_t* sizes = sizes_.data() + begin;
+        const uint8_t* jokers = jokers_.data() + begin;
+        const uint8_t* runs = runs_.data() + begin;
+        // Lanes first, then packing: the first loop vectorizes, a shift-or reduction would not.
+        uint8_t valid[64];
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            valid[lane] = static_cast<uint8_t>(valid_lane(kinds[lane], sizes[lane], jokers[lane], runs[lane]));
+        }
+        uint64_t bits = 0;
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            bits |= uint64_t(valid[lane]) << lane;
+        }
+        return bits;
+    }
+
+    std::pmr::vector<KindMask> kinds_;
+    std::pmr::vector<KindMask> second_copies_;
+    std::pmr::vector<uint8_t> sizes_;
+    std::pmr::vector<uint8_t> jokers_;
+    std::pmr::vector<uint8_t> joker_copies_;
+    std::pmr::vector<uint8_t> runs_;
+};
+
+} // namespace SetValidator
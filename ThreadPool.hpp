@@ -0,0 +1,205 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception> // For carrying a body's exception back to the caller
+#include <functional>
+#include <memory>
+#include <algorithm> // For std::min, std::max
+
+// Work-stealing thread pool.
+//
+// A pool of N threads is N - 1 workers plus whichever thread calls parallel_for: the caller
+// always runs part of its own loop, so N is the number of cores one parallel_for uses (a
+// loop started from several outside threads at once uses one more core per extra caller).
+//
+// Every worker owns a deque. parallel_for queues one runner task per helping thread,
+// round-robin; an owner takes tasks from the front of its own deque, and an idle worker
+// steals from the back of another worker's deque. Runners claim chunks from a shared
+// counter in index order (lowest first, which is what early-cancelling searches want), so
+// a loop costs one task per thread rather than one per chunk, and once it is cancelled no
+// further chunk is claimed. The caller helps with queued tasks until its loop is done, so
+// parallel_for may be called from inside a task.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threads = std::thread::hardware_concurrency())
+        : queues_(std::max<size_t>(threads, 1) - 1) {
+        for (size_t i = 0; i < queues_.size(); ++i) {
+            queues_[i] = std::make_unique<Queue>();
+        }
+        for (size_t i = 0; i < queues_.size(); ++i) {
+            workers_.emplace_back([this, i] { worker_loop(i); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Threads that run a parallel_for: the workers plus the caller.
+    size_t size() const {
+        return workers_.size() + 1;
+    }
+
+    // Runs body(i) for every i in [0, count), in chunks of `grain` indices, and returns once
+    // all of them have run. body must be safe to call concurrently.
+    //
+    // Once `cancel` (if given) is set, no further chunk is started and a running chunk stops
+    // before its next index. An exception thrown by body cancels the loop the same way and
+    // is rethrown here once every started chunk has finished; if several chunks throw, the
+    // first one caught wins.
+    template <typename Body>
+    void parallel_for(size_t count, size_t grain, Body body, const std::atomic<bool>* cancel = nullptr) {
+        if (count == 0) {
+            return;
+        }
+        grain = std::max<size_t>(grain, 1);
+        size_t chunks = (count + grain - 1) / grain;
+        size_t helpers = std::min(chunks, size()) - 1;
+        auto loop = std::make_shared<Loop>();
+        loop->running.store(helpers, std::memory_order_relaxed);
+
+        auto run_chunks = [&body, count, grain, chunks, cancel](Loop& state) {
+            try {
+                while (!state.stopped(cancel)) {
+                    size_t chunk = state.next_chunk.fetch_add(1, std::memory_order_relaxed);
+                    if (chunk >= chunks) {
+                        break;
+                    }
+                    size_t end = std::min(count, (chunk + 1) * grain);
+                    for (size_t i = chunk * grain; i < end && !state.stopped(cancel); ++i) {
+                        body(i);
+                    }
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(state.error_mutex);
+                if (!state.error) {
+                    state.error = std::current_exception();
+                }
+                state.failed.store(true, std::memory_order_release);
+            }
+        };
+
+        if (helpers > 0) {
+            size_t first = next_queue_.fetch_add(helpers, std::memory_order_relaxed);
+            for (size_t h = 0; h < helpers; ++h) {
+                Queue& queue = *queues_[(first + h) % queues_.size()];
+                pending_.fetch_add(1, std::memory_order_release);
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                queue.tasks.push_back([run_chunks, loop] {
+                    run_chunks(*loop);
+                    loop->running.fetch_sub(1, std::memory_order_acq_rel);
+                });
+            }
+            {
+                std::lock_guard<std::mutex> lock(wake_mutex_);
+            }
+            wake_.notify_all();
+        }
+
+        run_chunks(*loop);
+
+        // Help out instead of blocking while queued runners of this loop finish (a runner
+        // that starts after the last chunk was claimed returns at once).
+        while (loop->running.load(std::memory_order_acquire) != 0) {
+            std::function<void()> task;
+            if (steal(0, task)) {
+                task();
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        if (loop->error) {
+            std::rethrow_exception(loop->error);
+        }
+    }
+
+    // Shared pool sized to the machine.
+    static ThreadPool& instance() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    // Shared by the runners of one parallel_for.
+    struct Loop {
+        std::atomic<size_t> next_chunk{0};
+        std::atomic<size_t> running{0}; // Queued runners that have not finished.
+        std::atomic<bool> failed{false};
+        std::mutex error_mutex;
+        std::exception_ptr error;
+
+        bool stopped(const std::atomic<bool>* cancel) const {
+            return failed.load(std::memory_order_acquire) ||
+                   (cancel && cancel->load(std::memory_order_acquire));
+        }
+    };
+
+    bool pop_own(size_t self, std::function<void()>& task) {
+        Queue& queue = *queues_[self];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) {
+            return false;
+        }
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        pending_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool steal(size_t start, std::function<void()>& task) {
+        for (size_t offset = 0; offset < queues_.size(); ++offset) {
+            Queue& queue = *queues_[(start + offset) % queues_.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty()) {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+                pending_.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void worker_loop(size_t self) {
+        while (true) {
+            std::function<void()> task;
+            if (pop_own(self, task) || steal(self + 1, task)) {
+                task();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(wake_mutex_);
+            wake_.wait(lock, [this] { return stopping_ || pending_.load(std::memory_order_acquire) > 0; });
+            if (stopping_ && pending_.load(std::memory_order_acquire) == 0) {
+                return;
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> workers_;
+    std::atomic<size_t> pending_{0};
+    std::atomic<size_t> next_queue_{0};
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+};
@@ -18,33 +18,62 @@
 #include "Tile.hpp"
 
 void Tile::print() const {
-	if( color == 1 ) {
-		cout << BLUE;
-	} else if( color == 2 ) {
-		cout << PURPLE;
-	} else if( color == 3 ) {
-		cout << RED;
-	} else if( color == 4 ) {
-		cout << YELLOW;
+	static const char *const colors[] = { "", BLUE, PURPLE, RED, YELLOW };
+
+	if( isJoker() ) {
+		cout << "J " << NONE;
+		return;
 	}
 
-	cout << number << " " << NONE;
+	cout << colors[getColor()] << getNumber() << " " << NONE;
 }
 
-bool Tile::operator==( const Tile &other ) const {
-	if( this->getColor() != other.getColor() ) {
-		return false;
-	} else if( this->getNumber() != other.getNumber() ) {
-		return false;
+string Tile::toString() const {
+	static const char letters[] = { '?', 'B', 'P', 'R', 'Y' };
+	string text( 1, isJoker() ? 'J' : letters[getColor()] );
+
+	if( !isJoker() ) {
+		text += to_string( getNumber() );
+	}
+
+	if( getCopy() ) {
+		text += '\'';
 	}
 
-	return true;
+	return text;
 }
 
-bool operator<( const Tile &t1, const Tile &t2 ) {
-	if( t1.getColor() != t2.getColor() ) {
-		return t1.getColor() < t2.getColor();
-	} else {
-		return t1.getNumber() < t2.getNumber();
+optional<Tile> Tile::fromString( const string &text ) {
+	static const string letters = "BPRY";
+	size_t end = text.size();
+	int copy = 0;
+
+	if( end > 0 && text[end - 1] == '\'' ) {
+		copy = 1;
+		end--;
+	}
+
+	if( end == 1 && text[0] == 'J' ) {
+		return Tile::joker( copy );
+	}
+
+	if( end < 2 || end > 3 || letters.find( text[0] ) == string::npos ) {
+		return nullopt;
+	}
+
+	int number = 0;
+
+	for( size_t i = 1; i < end; i++ ) {
+		if( text[i] < '0' || text[i] > '9' ) {
+			return nullopt;
+		}
+
+		number = number * 10 + ( text[i] - '0' );
+	}
+
+	if( number < 1 || number > TileCode::NUM_NUMBERS ) {
+		return nullopt;
 	}
+
+	return Tile( number, static_cast<int>( letters.find( text[0] ) ) + 1, copy );
 }
@@ -16,7 +16,10 @@
  */
 
 #pragma once
+#include <cstdint>
 #include <iostream>
+#include <optional>
+#include <string>
 #define COLOR 1
 #include "color.h"
 
@@ -29,30 +32,177 @@ enum color {
 	yellow = 4
 };
 
+/*
+ * Packed tile encoding.
+ *
+ * A tile is a single byte: code = kind * 2 + copy, where kind = row * 13 + (number - 1)
+ * and row = color - 1. Kinds 0..51 are the playable tiles; colors outside 1..4 land on
+ * a spare fifth row so that legacy Tile( n, 0 ) values still round-trip, but they never
+ * take part in any set. The two jokers are the kind after the spare row, with number and
+ * color 0. Numbers outside 1..13 map to the kind after the jokers, which also decodes as
+ * number and color 0 and belongs to no set, so they never alias a real tile. Because the
+ * kind occupies the high bits, sorting codes as plain integers orders tiles by color, then
+ * number, then copy; the spare row and the jokers come after the playable tiles, and
+ * invalid codes after the jokers.
+ */
+namespace TileCode {
+
+constexpr int NUM_COLORS = 4;
+constexpr int NUM_NUMBERS = 13;
+constexpr int NUM_KINDS = NUM_COLORS * NUM_NUMBERS;
+constexpr int NUM_ROWS = NUM_COLORS + 1;
+constexpr int NUM_CODES = 256;
+constexpr uint8_t COPY_BIT = 1;
+constexpr int JOKER_KIND = NUM_ROWS * NUM_NUMBERS;
+constexpr int NUM_JOKERS = 2;
+constexpr int INVALID_KIND = JOKER_KIND + 1;
+
+constexpr int rowOf( int c ) {
+	return ( c >= 1 && c <= NUM_COLORS ) ? c - 1 : NUM_COLORS;
+}
+
+constexpr int kindOf( int number, int c ) {
+	if( number < 1 || number > NUM_NUMBERS ) {
+		return INVALID_KIND;
+	}
+
+	return rowOf( c ) * NUM_NUMBERS + ( number - 1 );
+}
+
+constexpr uint8_t encode( int number, int c, int copy = 0 ) {
+	return static_cast<uint8_t>( ( kindOf( number, c ) << 1 ) | ( copy & COPY_BIT ) );
+}
+
+struct Tables {
+	uint8_t number[NUM_CODES];
+	uint8_t color[NUM_CODES];
+};
+
+constexpr Tables makeTables() {
+	Tables t{};
+
+	for( int code = 0; code < NUM_CODES; code++ ) {
+		int kind = code >> 1;
+
+		if( kind < NUM_ROWS * NUM_NUMBERS ) {
+			int row = kind / NUM_NUMBERS;
+			t.number[code] = static_cast<uint8_t>( kind % NUM_NUMBERS + 1 );
+			t.color[code] = static_cast<uint8_t>( row < NUM_COLORS ? row + 1 : 0 );
+		}
+	}
+
+	return t;
+}
+
+inline constexpr Tables TABLES = makeTables();
+
+constexpr int number( uint8_t code ) {
+	return TABLES.number[code];
+}
+
+constexpr int color( uint8_t code ) {
+	return TABLES.color[code];
+}
+
+constexpr int kind( uint8_t code ) {
+	return code >> 1;
+}
+
+constexpr int copy( uint8_t code ) {
+	return code & COPY_BIT;
+}
+
+constexpr bool isPlayableKind( int k ) {
+	return k >= 0 && k < NUM_KINDS;
+}
+
+constexpr bool isJokerKind( int k ) {
+	return k == JOKER_KIND;
+}
+
+constexpr int kindNumber( int k ) {
+	return k % NUM_NUMBERS + 1;
+}
+
+constexpr int kindColor( int k ) {
+	return k / NUM_NUMBERS + 1;
+}
+
+// One bit per playable kind; 52 kinds fit in a single word.
+using KindMask = uint64_t;
+
+constexpr KindMask kindBit( int k ) {
+	return isPlayableKind( k ) ? KindMask( 1 ) << k : 0;
+}
+
+} // namespace TileCode
+
+/*
+ * Thin view over a packed tile code. Equality and ordering compare the whole code, so two
+ * copies of the same kind are distinct physical tiles; use sameKind() for rule checks.
+ */
 class Tile {
-	int number;
-	int color;
+	uint8_t code;
+
+	struct FromCode {};
+	constexpr Tile( uint8_t c, FromCode ) : code( c ) {}
 public:
+	constexpr Tile( int n, int c, int copy = 0 ) : code( TileCode::encode( n, c, copy ) ) {}
+
+	static constexpr Tile fromCode( uint8_t c ) {
+		return Tile( c, FromCode() );
+	}
+
+	static constexpr Tile joker( int copy = 0 ) {
+		return fromCode( static_cast<uint8_t>( ( TileCode::JOKER_KIND << 1 ) | ( copy & TileCode::COPY_BIT ) ) );
+	}
+
 	void setNumber( int n ) {
-		number = n;
+		code = TileCode::encode( n, getColor(), getCopy() );
 	}
 	void setColor( int c ) {
-		color = c;
+		code = TileCode::encode( getNumber(), c, getCopy() );
+	}
+	constexpr int getNumber() const {
+		return TileCode::number( code );
+	}
+	constexpr int getColor() const {
+		return TileCode::color( code );
 	}
-	int getNumber() const {
-		return number;
+	constexpr int getCopy() const {
+		return TileCode::copy( code );
 	}
-	int getColor() const {
-		return color;
+	constexpr int getKind() const {
+		return TileCode::kind( code );
+	}
+	constexpr uint8_t getCode() const {
+		return code;
+	}
+	// The copy-0 tile of the same kind, used where only the kind matters (set templates).
+	constexpr Tile firstCopy() const {
+		return fromCode( static_cast<uint8_t>( code & ~TileCode::COPY_BIT ) );
+	}
+	constexpr bool sameKind( const Tile &other ) const {
+		return getKind() == other.getKind();
+	}
+	constexpr bool isJoker() const {
+		return TileCode::isJokerKind( getKind() );
 	}
 	void print() const;
-	bool operator==( const Tile &other ) const;
-	Tile( int n, int c ) {
-		number = n;
-		color = c;
+	// Text form used by position files: color letter (B, P, R, Y), number, and a trailing
+	// apostrophe for the second copy, e.g. "R7" or "B13'". Jokers are "J" and "J'".
+	string toString() const;
+	static optional<Tile> fromString( const string &text );
+	constexpr bool operator==( const Tile &other ) const {
+		return code == other.code;
+	}
+	constexpr bool operator!=( const Tile &other ) const {
+		return code != other.code;
 	}
 };
 
-// Ensure only the declaration of operator< is here
-bool operator<( const Tile &t1, const Tile &t2 );
+static_assert( sizeof( Tile ) == 1, "Tile must stay a single packed byte" );
 
+constexpr bool operator<( const Tile &t1, const Tile &t2 ) {
+	return t1.getCode() < t2.getCode();
+}
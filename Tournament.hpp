@@ -0,0 +1,130 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <chrono>
+#include <thread>    // For std::thread::id
+#include <algorithm> // For std::sort, std::unique
+
+#include "Game.hpp"              // For Game, Game::Result
+#include "ThreadPool.hpp"        // For spreading games across cores
+#include "Zobrist.hpp"           // For splitmix64
+#include "PerformanceTracer.hpp" // For TRACE_FUNCTION
+
+// Monte Carlo tournament: many self-play games spread across a thread pool.
+//
+// Game i of a tournament is dealt from game_seed(base_seed, i), the i-th output of a
+// SplitMix64 stream, so every game has its own independent seed and replay() reproduces any
+// single game without running the others. Games are split into contiguous blocks; each
+// block plays on its own Game and fills its own Tally, and the tallies are merged in block
+// order afterwards. No locks are taken, and the totals do not depend on the thread count.
+namespace Tournament {
+
+inline uint64_t game_seed(uint64_t base_seed, uint64_t game_index) {
+    return Zobrist::splitmix64(base_seed + game_index * 0x9E3779B97F4A7C15ULL);
+}
+
+struct alignas(64) Tally { // One cache line per block, so blocks never share a line.
+    uint64_t games = 0;
+    uint64_t blocked = 0;
+    uint64_t turns = 0;
+    std::array<uint64_t, Game::MAX_PLAYERS> wins{};
+    std::array<int64_t, Game::MAX_PLAYERS> scores{};
+    double busy_seconds = 0; // Time spent playing, summed over blocks (thread-seconds: blocks
+                             // on different threads overlap in wall-clock time).
+
+    void add(const Game::Result& result) {
+        ++games;
+        blocked += result.blocked;
+        turns += result.turns;
+        ++wins[result.winner];
+        for (int p = 0; p < Game::MAX_PLAYERS; ++p) {
+            scores[p] += result.scores[p];
+        }
+    }
+
+    void merge(const Tally& other) {
+        games += other.games;
+        blocked += other.blocked;
+        turns += other.turns;
+        for (int p = 0; p < Game::MAX_PLAYERS; ++p) {
+            wins[p] += other.wins[p];
+            scores[p] += other.scores[p];
+        }
+        busy_seconds += other.busy_seconds;
+    }
+};
+
+struct Summary {
+    Game::Config config;
+    uint64_t base_seed = 0;
+    size_t threads = 0;      // The pool's size: the most threads the run could use.
+    size_t threads_used = 0; // Threads that actually played a block.
+    double seconds = 0;      // Wall-clock time of the whole run.
+    Tally tally;
+
+    double win_rate(int player) const {
+        return tally.games ? static_cast<double>(tally.wins[player]) / tally.games : 0;
+    }
+
+    double average_turns() const {
+        return tally.games ? static_cast<double>(tally.turns) / tally.games : 0;
+    }
+
+    double average_score(int player) const {
+        return tally.games ? static_cast<double>(tally.scores[player]) / tally.games : 0;
+    }
+
+    double games_per_second() const {
+        return seconds > 0 ? tally.games / seconds : 0;
+    }
+
+    // Throughput of one thread while it plays: games per thread-second of block time. Up to
+    // threads_used blocks run at once, so this times threads_used bounds games_per_second.
+    double games_per_thread_second() const {
+        return tally.busy_seconds > 0 ? tally.games / tally.busy_seconds : 0;
+    }
+};
+
+constexpr size_t BLOCKS_PER_THREAD = 8; // Enough blocks to even out long and short games.
+
+inline Summary run(uint64_t games, const Game::Config& config, uint64_t base_seed,
+                   ThreadPool& pool = ThreadPool::instance()) {
+    TRACE_FUNCTION();
+    Summary summary;
+    summary.config = config;
+    summary.base_seed = base_seed;
+    summary.threads = pool.size();
+
+    size_t blocks = static_cast<size_t>(std::min<uint64_t>(games, pool.size() * BLOCKS_PER_THREAD));
+    std::vector<Tally> tallies(blocks);
+    std::vector<std::thread::id> block_threads(blocks);
+    auto start = std::chrono::steady_clock::now();
+    pool.parallel_for(blocks, 1, [&](size_t block) {
+        auto block_start = std::chrono::steady_clock::now();
+        block_threads[block] = std::this_thread::get_id();
+        Game game(config);
+        Tally& tally = tallies[block];
+        for (uint64_t i = games * block / blocks; i < games * (block + 1) / blocks; ++i) {
+            tally.add(game.play(game_seed(base_seed, i)));
+        }
+        tally.busy_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - block_start).count();
+    });
+    summary.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (const auto& tally : tallies) {
+        summary.tally.merge(tally);
+    }
+    std::sort(block_threads.begin(), block_threads.end());
+    summary.threads_used = std::unique(block_threads.begin(), block_threads.end()) - block_threads.begin();
+    return summary;
+}
+
+// Replays game `game_index` of the tournament started from base_seed. The game is left on
+// `game` for inspection; pass a fresh Game with the tournament's config.
+inline const Game::Result& replay(Game& game, uint64_t base_seed, uint64_t game_index) {
+    return game.play(game_seed(base_seed, game_index));
+}
+
+} // namespace Tournament
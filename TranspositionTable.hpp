@@ -0,0 +1,106 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "Tile.hpp"
+#include "Zobrist.hpp" // For pool keys
+
+// Memo of sub-pools already proven impossible to arrange, for the backtracking search.
+// The same remaining pool is reached through many orders of candidate sets; once one of
+// them has failed, every other order can stop immediately.
+//
+// The table is direct-mapped with a fixed number of slots, so memory stays bounded no
+// matter how long it is reused. Keys only depend on the tile kinds left in the pool, so a
+// table may be shared across calls.
+
+enum class ReplacementPolicy {
+    ALWAYS_REPLACE,     // The newest entry wins its slot.
+    PREFER_LARGER_POOL  // Keep whichever entry covers the larger sub-pool (more work saved).
+};
+
+class TranspositionTable {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = size_t(1) << 16;
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t stores = 0;
+        uint64_t evictions = 0;
+    };
+
+    // Capacity is rounded up to a power of two (at least one slot).
+    explicit TranspositionTable(size_t capacity = DEFAULT_CAPACITY,
+                                ReplacementPolicy policy = ReplacementPolicy::PREFER_LARGER_POOL)
+        : policy_(policy) {
+        size_t slots = 1;
+        while (slots < capacity) {
+            slots <<= 1;
+        }
+        entries_.assign(slots, Entry{});
+        mask_ = slots - 1;
+    }
+
+    // True if the pool with this key is known to have no arrangement.
+    bool probe_infeasible(uint64_t key) {
+        const Entry& entry = entries_[key & mask_];
+        if (entry.pool_size != 0 && entry.key == key) {
+            ++stats_.hits;
+            return true;
+        }
+        ++stats_.misses;
+        return false;
+    }
+
+    // Records that the pool with this key (holding pool_size tiles) has no arrangement.
+    void store_infeasible(uint64_t key, size_t pool_size) {
+        Entry& entry = entries_[key & mask_];
+        uint8_t size = static_cast<uint8_t>(pool_size > 255 ? 255 : (pool_size == 0 ? 1 : pool_size));
+        if (entry.pool_size != 0 && entry.key != key) {
+            if (policy_ == ReplacementPolicy::PREFER_LARGER_POOL && entry.pool_size > size) {
+                return;
+            }
+            ++stats_.evictions;
+        }
+        entry.key = key;
+        entry.pool_size = size;
+        ++stats_.stores;
+    }
+
+    void clear() {
+        entries_.assign(entries_.size(), Entry{});
+        stats_ = Stats{};
+    }
+
+    size_t capacity() const {
+        return entries_.size();
+    }
+
+    size_t memory_bytes() const {
+        return entries_.size() * sizeof(Entry);
+    }
+
+    const Stats& stats() const {
+        return stats_;
+    }
+
+private:
+    struct Entry {
+        uint64_t key = 0;
+        uint8_t pool_size = 0; // 0 marks an empty slot.
+    };
+
+    std::vector<Entry> entries_;
+    size_t mask_ = 0;
+    ReplacementPolicy policy_;
+    Stats stats_;
+};
+
+// Canonical key of a pool: its Zobrist hash, which depends only on how many tiles of each
+// kind it holds, not on their order or which physical copies they are. Pool is any
+// container of Tile.
+template <typename Pool = std::vector<Tile>>
+inline uint64_t pool_key(const Pool& pool) {
+    return Zobrist::hash_tiles(pool);
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <cstdint>
+#include "GameTypes.hpp" // For GameSet, SetType, Tile
+
+// Zobrist hashing over tile kinds.
+//
+// A multiset of tiles hashes to the XOR, over kinds, of a random key for (kind, count).
+// Adding or removing one tile therefore costs two XORs, which is what the search uses for
+// make/unmake. Hashes ignore tile order and which physical copy is present, so two pools
+// or boards with the same kinds always agree.
+namespace Zobrist {
+
+constexpr int TRACKED_COUNTS = 8; // Counts are taken modulo this; real pools hold at most 2.
+constexpr int NUM_KIND_SLOTS = TileCode::NUM_CODES / 2;
+
+constexpr uint64_t splitmix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+struct Keys {
+    uint64_t count[NUM_KIND_SLOTS][TRACKED_COUNTS];
+    uint64_t set_type[2];
+};
+
+constexpr Keys make_keys() {
+    Keys keys{};
+    uint64_t seed = 0x52756D6D696B7562ULL;
+    for (int kind = 0; kind < NUM_KIND_SLOTS; ++kind) {
+        for (int count = 1; count < TRACKED_COUNTS; ++count) {
+            keys.count[kind][count] = splitmix64(seed++);
+        }
+    }
+    keys.set_type[0] = splitmix64(seed++);
+    keys.set_type[1] = splitmix64(seed++);
+    return keys;
+}
+
+inline constexpr Keys KEYS = make_keys();
+
+// Key of holding `count` tiles of `kind`; holding none contributes nothing.
+constexpr uint64_t count_key(int kind, int count) {
+    return KEYS.count[kind][count % TRACKED_COUNTS];
+}
+
+// Incrementally maintained hash of a tile multiset.
+class PoolHash {
+public:
+    PoolHash() = default;
+
+    template <typename Tiles>
+    explicit PoolHash(const Tiles& tiles) {
+        for (const auto& tile : tiles) {
+            add(tile);
+        }
+    }
+
+    void add(Tile tile) {
+        int kind = tile.getKind();
+        hash_ ^= count_key(kind, counts_[kind]) ^ count_key(kind, counts_[kind] + 1);
+        ++counts_[kind];
+    }
+
+    void remove(Tile tile) {
+        int kind = tile.getKind();
+        hash_ ^= count_key(kind, counts_[kind]) ^ count_key(kind, counts_[kind] - 1);
+        --counts_[kind];
+    }
+
+    uint64_t value() const {
+        return hash_;
+    }
+
+    int count(int kind) const {
+        return counts_[kind];
+    }
+
+private:
+    std::array<uint8_t, NUM_KIND_SLOTS> counts_{};
+    uint64_t hash_ = 0;
+};
+
+template <typename Tiles = std::vector<Tile>>
+inline uint64_t hash_tiles(const Tiles& tiles) {
+    return PoolHash(tiles).value();
+}
+
+// Hash of one set: its kinds and its type, mixed so that set hashes can be summed.
+inline uint64_t hash_set(const GameSet& set) {
+    return splitmix64(hash_tiles(set.tiles) ^ KEYS.set_type[static_cast<int>(set.type)]);
+}
+
+} // namespace Zobrist
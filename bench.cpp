@@ -0,0 +1,246 @@
+/*
+ * Microbenchmarks for the tracer, the set and board validators, the set finder, the move
+ * search and self-play turns.
+ *
+ *   ./bench [--min-time seconds] [--filter text] [--quick]
+ *
+ * Every case runs for at least --min-time seconds (default 0.2) and prints one
+ * tab-separated line; see Benchmark.hpp for the columns. --filter keeps the cases whose
+ * "benchmark params" text contains the given text, and --quick trims the board and hand
+ * sweeps to their end points. Board and hand sizes that need more than the 104 numbered
+ * tiles are skipped. Inputs come from fixed seeds, so two builds measure the same
+ * positions.
+ */
+
+#include "Benchmark.hpp"
+#include "AllocationHook.hpp" // Counts allocations for allocs_per_op
+#include "Board.hpp"
+#include "SetFinder.hpp"
+#include "SetValidator.hpp"
+#include "MoveFinder.hpp"
+#include "ExactCover.hpp"
+#include "Game.hpp"
+#include "PerformanceTracer.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int INPUTS_PER_CASE = 32; // Distinct inputs each case cycles through.
+constexpr uint64_t SEED = 12345;
+
+struct Options {
+    double min_seconds = 0.2;
+    std::string filter;
+    bool quick = false;
+};
+
+bool selected(const Options& options, const std::string& name, const std::string& params) {
+    return options.filter.empty() || (name + " " + params).find(options.filter) != std::string::npos;
+}
+
+template <typename Op>
+void run_case(const Options& options, const std::string& name, const std::string& params, Op op) {
+    if (selected(options, name, params)) {
+        Benchmark::print_result(std::cout, Benchmark::measure(name, params, options.min_seconds, op));
+    }
+}
+
+// Tiles of a random catalog set of the given type and size, with random copies.
+std::vector<Tile> random_set(SetType type, int size, std::mt19937_64& rng) {
+    std::vector<int> matching;
+    for (int i = 0; i < SetFinder::CATALOG_SIZE; ++i) {
+        if (SetFinder::CATALOG[i].type == type && SetFinder::CATALOG[i].size == size) {
+            matching.push_back(i);
+        }
+    }
+    const SetFinder::CatalogEntry& entry = SetFinder::CATALOG[matching[rng() % matching.size()]];
+    std::vector<Tile> tiles;
+    for (TileCode::KindMask rest = entry.mask; rest != 0; rest &= rest - 1) {
+        tiles.push_back(Tile::fromCode(static_cast<uint8_t>(__builtin_ctzll(rest) * 2 + rng() % 2)));
+    }
+    std::shuffle(tiles.begin(), tiles.end(), rng);
+    return tiles;
+}
+
+void bench_validators(const Options& options) {
+    std::mt19937_64 rng(SEED);
+    for (int size = 3; size <= TileCode::NUM_NUMBERS; ++size) {
+        std::vector<std::vector<Tile>> inputs;
+        for (int i = 0; i < INPUTS_PER_CASE; ++i) {
+            inputs.push_back(random_set(SetType::RUN, size, rng));
+        }
+        run_case(options, "isValidRun", "size=" + std::to_string(size), [&](uint64_t i) {
+            Benchmark::keep(isValidRun(inputs[i % INPUTS_PER_CASE]));
+        });
+    }
+    for (int size = 3; size <= TileCode::NUM_COLORS; ++size) {
+        std::vector<std::vector<Tile>> inputs;
+        for (int i = 0; i < INPUTS_PER_CASE; ++i) {
+            inputs.push_back(random_set(SetType::GROUP, size, rng));
+        }
+        run_case(options, "isValidGroup", "size=" + std::to_string(size), [&](uint64_t i) {
+            Benchmark::keep(isValidGroup(inputs[i % INPUTS_PER_CASE]));
+        });
+    }
+}
+
+// The whole catalog, with random copies, checked as one batch.
+void bench_batch_validation(const Options& options) {
+    std::mt19937_64 rng(SEED);
+    SetValidator::Batch batch;
+    for (const auto& entry : SetFinder::CATALOG) {
+        std::vector<Tile> tiles;
+        for (TileCode::KindMask rest = entry.mask; rest != 0; rest &= rest - 1) {
+            tiles.push_back(Tile::fromCode(static_cast<uint8_t>(__builtin_ctzll(rest) * 2 + rng() % 2)));
+        }
+        batch.add(tiles, entry.type);
+    }
+    std::vector<uint64_t> bitmap((batch.size() + 63) / 64);
+    run_case(options, "SetValidator::Batch::validate", "sets=" + std::to_string(batch.size()), [&](uint64_t) {
+        batch.validate(bitmap.data());
+        Benchmark::keep(bitmap[0]);
+    });
+}
+
+void bench_tracer(const Options& options) {
+    run_case(options, "trace_scope", "-", [](uint64_t i) {
+        TRACE_SCOPE_ALWAYS("bench trace_scope");
+        Benchmark::keep(i);
+    });
+}
+
+void bench_positions(const Options& options) {
+    std::vector<int> board_sizes = {0, 15, 30, 45, 60, 75, 90};
+    std::vector<int> hand_sizes = {1, 5, 10, 14, 20};
+    if (options.quick) {
+        board_sizes = {0, 90};
+        hand_sizes = {1, 14};
+    }
+
+    for (int board_tiles : board_sizes) {
+        for (int hand_size : hand_sizes) {
+            if (board_tiles + hand_size > TileCode::NUM_KINDS * 2) {
+                continue; // Not enough tiles left for the hand.
+            }
+            std::mt19937_64 rng(SEED + board_tiles * 100 + hand_size);
+            std::vector<Benchmark::Position> positions;
+            std::vector<std::vector<Tile>> pools;
+            std::vector<std::vector<Tile>> additions;
+            for (int i = 0; i < INPUTS_PER_CASE; ++i) {
+                Benchmark::Position position = Benchmark::random_position(board_tiles, hand_size, rng);
+                std::vector<Tile> pool = position.board.getAllTiles();
+                pool.insert(pool.end(), position.hand.begin(), position.hand.end());
+                pools.push_back(pool);
+
+                // can_add_tiles_to_board is timed on the tiles the best move plays (its hot
+                // use), or on the whole hand when there is no move.
+                std::optional<Move> move = MoveFinder::find_best_move(position.board, position.hand);
+                if (move) {
+                    std::vector<Tile> played;
+                    std::set_difference(position.hand.begin(), position.hand.end(),
+                                        move->remaining_hand.begin(), move->remaining_hand.end(),
+                                        std::back_inserter(played));
+                    additions.push_back(played);
+                } else {
+                    additions.push_back(position.hand);
+                }
+                positions.push_back(position);
+            }
+
+            std::string params = "board=" + std::to_string(board_tiles) + " hand=" + std::to_string(hand_size);
+            run_case(options, "find_all_possible_sets", params, [&](uint64_t i) {
+                Benchmark::keep(SetFinder::find_all_possible_sets(pools[i % INPUTS_PER_CASE]));
+            });
+            run_case(options, "ExactCover::solve", params, [&](uint64_t i) {
+                Benchmark::keep(ExactCover::solve(pools[i % INPUTS_PER_CASE]));
+            });
+            run_case(options, "is_board_valid", params, [&](uint64_t i) {
+                Benchmark::keep(is_board_valid(positions[i % INPUTS_PER_CASE].board.sets));
+            });
+            if (board_tiles > 0) {
+                // One set edit plus the validity query that follows it.
+                run_case(options, "BoardState::replaceSet", params, [&](uint64_t i) {
+                    BoardState& board = positions[i % INPUTS_PER_CASE].board;
+                    size_t index = (i / INPUTS_PER_CASE) % board.sets.size();
+                    board.replaceSet(index, board.sets[index]);
+                    Benchmark::keep(board.isValidBoard());
+                });
+            }
+            run_case(options, "can_add_tiles_to_board", params, [&](uint64_t i) {
+                const Benchmark::Position& position = positions[i % INPUTS_PER_CASE];
+                Benchmark::keep(BoardManipulation::can_add_tiles_to_board(position.board, additions[i % INPUTS_PER_CASE]));
+            });
+            if (board_tiles <= 30) {
+                // The exhaustive reference; larger boards take seconds per call.
+                run_case(options, "can_add_tiles_to_board_reference", params, [&](uint64_t i) {
+                    const Benchmark::Position& position = positions[i % INPUTS_PER_CASE];
+                    Benchmark::keep(BoardManipulation::can_add_tiles_to_board_reference(position.board, additions[i % INPUTS_PER_CASE]));
+                });
+            }
+            run_case(options, "find_best_move", params, [&](uint64_t i) {
+                const Benchmark::Position& position = positions[i % INPUTS_PER_CASE];
+                Benchmark::keep(MoveFinder::find_best_move(position.board, position.hand));
+            });
+            run_case(options, "find_best_move_parallel", params, [&](uint64_t i) {
+                const Benchmark::Position& position = positions[i % INPUTS_PER_CASE];
+                Benchmark::keep(MoveFinder::find_best_move_parallel(position.board, position.hand));
+            });
+            run_case(options, "find_best_move_anytime", params + " deadline=1ms", [&](uint64_t i) {
+                const Benchmark::Position& position = positions[i % INPUTS_PER_CASE];
+                MoveFinder::SearchLimits limits;
+                limits.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(1);
+                Benchmark::keep(MoveFinder::find_best_move_anytime(position.board, position.hand, limits));
+            });
+        }
+    }
+}
+
+// One self-play turn on a warmed-up Game; a finished game is dealt again with the next seed.
+void bench_game(const Options& options) {
+    for (int players = Game::MIN_PLAYERS; players <= Game::MAX_PLAYERS; players += 2) {
+        Game::Config config;
+        config.players = players;
+        Game game(config);
+        uint64_t seed = SEED;
+        game.play(seed++);
+        game.deal(seed++);
+        run_case(options, "Game::play_turn", "players=" + std::to_string(players), [&](uint64_t) {
+            if (game.is_over()) {
+                game.deal(seed++);
+            }
+            Benchmark::keep(game.play_turn());
+        });
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            options.min_seconds = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else if (std::strcmp(argv[i], "--quick") == 0) {
+            options.quick = true;
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--min-time seconds] [--filter text] [--quick]" << std::endl;
+            return 1;
+        }
+    }
+
+    Benchmark::print_header(std::cout);
+    bench_tracer(options);
+    bench_validators(options);
+    bench_batch_validation(options);
+    bench_positions(options);
+    bench_game(options);
+    return 0;
+}
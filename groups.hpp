@@ -39,29 +39,45 @@ vector<vector<Tile>> findGroups( vector<Tile> tiles ) {
 	return result;
 }
 
-bool isValidGroup( vector<Tile> tiles ) {
+/*
+ * Jokers stand in for any missing color.
+ * @param Tiles tiles  vector<Tile>, or a GameSet's inline SetTiles
+ * @return bool
+ */
+template <typename Tiles = vector<Tile>>
+bool isValidGroup( const Tiles &tiles ) {
 	// Groups must be either 3 or 4 tiles
 	if( tiles.size() < 3 || tiles.size() > 4 ) {
 		return false;
 	}
 
-	set<int> uniqueColors;
-	auto number = tiles[0].getNumber();
+	int colors = 0; // One bit per color seen
+	auto number = 0; // Of the first numbered tile; playable numbers start at 1
 
 	for( auto tile : tiles ) {
-		uniqueColors.insert( tile.getColor() );
+		if( tile.isJoker() ) {
+			continue;
+		}
+
+		// Tiles off the four colors or outside 1..13 belong to no group
+		if( !TileCode::isPlayableKind( tile.getKind() ) ) {
+			return false;
+		}
+
+		// All tiles must have a different color
+		if( colors & ( 1 << tile.getColor() ) ) {
+			return false;
+		}
+
+		colors |= 1 << tile.getColor();
 
 		// All tiles must have the same number
-		if( tile.getNumber() != number ) {
+		if( number != 0 && tile.getNumber() != number ) {
 			return false;
 		}
-	}
 
-	// All tiles must have a different color
-	if( uniqueColors.size() != tiles.size() ) {
-		return false;
+		number = tile.getNumber();
 	}
 
 	return true;
 }
-
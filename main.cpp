@@ -19,13 +19,190 @@
 #include "utilities.hpp"
 #include "groups.hpp"
 #include "runs.hpp"
+#include "Analyzer.hpp"
+#include "Game.hpp"
+#include "Tournament.hpp"
 #include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <random>
 #include <vector>
 
-int main() {
-	srand( time( nullptr ) );
+/*
+ * rummikub analyze [file]
+ * Reads positions from the file (or stdin when omitted or "-") and writes one best move per line.
+ * @return int exit status
+ */
+int analyze( int argc, char **argv ) {
+	ifstream file;
+	istream *in = &cin;
+
+	if( argc > 2 && strcmp( argv[2], "-" ) != 0 ) {
+		file.open( argv[2] );
+
+		if( !file ) {
+			cerr << "rummikub: cannot open " << argv[2] << endl;
+			return 1;
+		}
+
+		in = &file;
+	}
+
+	ios::sync_with_stdio( false );
+	auto start = chrono::steady_clock::now();
+	size_t records = Analyzer::run( *in, cout );
+	double seconds = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+	cerr << "analyzed " << records << " positions in " << seconds << " s on "
+	     << ThreadPool::instance().size() << " threads" << endl;
+	return 0;
+}
+
+/*
+ * rummikub selfplay [games] [players] [seed]
+ * Plays games on one core with find_best_move for every seat and reports games per second.
+ * Game i is dealt from seed + i.
+ * @return int exit status
+ */
+int selfplay( int argc, char **argv ) {
+	long games = argc > 2 ? atol( argv[2] ) : 1000;
+	Game::Config config;
+	config.players = argc > 3 ? atoi( argv[3] ) : Game::MIN_PLAYERS;
+	uint64_t seed = argc > 4 ? strtoull( argv[4], nullptr, 10 ) : 1;
+	Game game( config );
+	long turns = 0, blocked = 0;
+	vector<long> wins( game.players(), 0 );
+
+	auto start = chrono::steady_clock::now();
+
+	for( long i = 0; i < games; i++ ) {
+		const Game::Result &result = game.play( seed + i );
+		turns += result.turns;
+		blocked += result.blocked;
+		wins[result.winner]++;
+	}
+
+	double seconds = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+	cout << games << " games, " << game.players() << " players, "
+	     << ( games ? double( turns ) / games : 0 ) << " turns/game, " << blocked << " blocked" << endl;
+
+	for( int p = 0; p < game.players(); p++ ) {
+		cout << "player " << p << ": " << wins[p] << " wins" << endl;
+	}
+
+	cout << ( seconds > 0 ? games / seconds : 0 ) << " games/s" << endl;
+	return 0;
+}
+
+/*
+ * rummikub tournament [games] [players] [seed]
+ * Plays games across all cores and reports win rates, scores, turns and throughput.
+ * @return int exit status
+ */
+int tournament( int argc, char **argv ) {
+	uint64_t games = argc > 2 ? strtoull( argv[2], nullptr, 10 ) : 10000;
+	Game::Config config;
+	config.players = argc > 3 ? atoi( argv[3] ) : Game::MIN_PLAYERS;
+	uint64_t seed = argc > 4 ? strtoull( argv[4], nullptr, 10 ) : 1;
+	Tournament::Summary summary = Tournament::run( games, config, seed );
+	int players = Game( config ).players();
+
+	cout << summary.tally.games << " games, " << players << " players, seed " << seed << endl;
+
+	for( int p = 0; p < players; p++ ) {
+		cout << "player " << p << ": win rate " << summary.win_rate( p )
+		     << ", average score " << summary.average_score( p ) << endl;
+	}
+
+	cout << summary.average_turns() << " turns/game, " << summary.tally.blocked << " blocked" << endl;
+	cout << summary.seconds << " s on " << summary.threads_used << " of " << summary.threads << " threads, "
+	     << summary.games_per_second() << " games/s, "
+	     << summary.games_per_thread_second() << " games/s per playing thread" << endl;
+	return 0;
+}
+
+/*
+ * rummikub replay <game> [players] [seed] [trace]
+ * Replays one game of "rummikub tournament" with the same players and seed, turn by turn.
+ * With a trace name, also writes a timeline of the game to <trace>.json (Chrome trace
+ * events, one span per turn and, in a TRACE=1 build, per traced function) and its call
+ * tree to <trace>.folded (folded stacks for flame graphs).
+ * @return int exit status
+ */
+int replay( int argc, char **argv ) {
+	if( argc < 3 ) {
+		cerr << "usage: rummikub replay <game> [players] [seed] [trace]" << endl;
+		return 1;
+	}
+
+	uint64_t index = strtoull( argv[2], nullptr, 10 );
+	Game::Config config;
+	config.players = argc > 3 ? atoi( argv[3] ) : Game::MIN_PLAYERS;
+	uint64_t seed = argc > 4 ? strtoull( argv[4], nullptr, 10 ) : 1;
+	const char *actions[] = { "meld", "play", "draw", "pass" };
+	const char *trace = argc > 5 ? argv[5] : nullptr;
+	Game game( config );
+	game.deal( Tournament::game_seed( seed, index ) );
+
+	if( trace ) {
+		PerformanceTracer::reset();
+		PerformanceTracer::start_timeline();
+	}
+
+	while( !game.is_over() ) {
+		TurnRecord turn;
+		{
+			TRACE_SCOPE_ALWAYS( "turn" );
+			turn = game.play_turn();
+		}
+		cout << "turn " << game.result().turns << ": player " << turn.player << " "
+		     << actions[static_cast<int>( turn.action )] << " " << turn.tiles_played << endl;
+	}
+
+	cout << "board: " << Analyzer::format_board( game.board() ) << endl;
+
+	for( int p = 0; p < game.players(); p++ ) {
+		cout << "player " << p << ": " << Analyzer::format_tiles( game.hand( p ) )
+		     << " (score " << game.result().scores[p] << ")" << endl;
+	}
+
+	cout << "winner: player " << game.result().winner << ( game.result().blocked ? " (blocked)" : "" ) << endl;
+
+	if( trace ) {
+		PerformanceTracer::stop_timeline();
+		ofstream timeline( string( trace ) + ".json" );
+		ofstream folded( string( trace ) + ".folded" );
+		PerformanceTracer::write_chrome_trace( timeline );
+		PerformanceTracer::write_folded_stacks( folded );
+
+		if( !timeline || !folded ) {
+			cerr << "rummikub: cannot write " << trace << ".json / .folded" << endl;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int main( int argc, char **argv ) {
+	if( argc > 1 && strcmp( argv[1], "analyze" ) == 0 ) {
+		return analyze( argc, argv );
+	}
+
+	if( argc > 1 && strcmp( argv[1], "selfplay" ) == 0 ) {
+		return selfplay( argc, argv );
+	}
+
+	if( argc > 1 && strcmp( argv[1], "tournament" ) == 0 ) {
+		return tournament( argc, argv );
+	}
+
+	if( argc > 1 && strcmp( argv[1], "replay" ) == 0 ) {
+		return replay( argc, argv );
+	}
+
+	mt19937_64 rng( time( nullptr ) );
 	vector<Tile> allTiles = generateAllTiles();
-	shuffle( &allTiles );
+	shuffle( &allTiles, rng );
 	vector<Tile> myHand = drawHand( &allTiles );
 	cout << "My hand:" << endl;
 
@@ -46,31 +46,59 @@ vector<vector<Tile>> findRuns( vector<Tile> tiles ) {
 
 }
 
-bool isValidRun( vector<Tile> tiles ) {
+/*
+ * Jokers stand in for any missing tile: first to fill gaps between the numbered tiles,
+ * then to extend the run at either end.
+ * @param Tiles unsorted  vector<Tile>, or a GameSet's inline SetTiles
+ * @return bool
+ */
+template <typename Tiles = vector<Tile>>
+bool isValidRun( const Tiles &unsorted ) {
 	// Runs must be at least 3 tiles long
-	if( tiles.size() < 3 ) {
+	if( unsorted.size() < 3 || unsorted.size() > TileCode::NUM_NUMBERS ) {
+		return false;
+	}
+
+	// Tiles off the four colors or outside 1..13 belong to no run (and sort after the jokers)
+	if( any_of( unsorted.begin(), unsorted.end(), []( Tile t ) {
+		return !t.isJoker() && !TileCode::isPlayableKind( t.getKind() );
+	} ) ) {
 		return false;
 	}
 
+	// Jokers sort after every playable tile
+	Tiles tiles( unsorted );
 	sort( tiles.begin(), tiles.end() );
+	size_t jokers = count_if( tiles.begin(), tiles.end(), []( Tile t ) {
+		return t.isJoker();
+	} );
+
+	if( jokers == tiles.size() ) {
+		return true;
+	}
 
 	auto color = tiles[0].getColor();
 	auto number = tiles[0].getNumber();
 
 	for( auto tile : tiles ) {
+		if( tile.isJoker() ) {
+			break;
+		}
+
 		// Runs must consist of tiles that are all the same color
 		if( tile.getColor() != color ) {
 			return false;
 		}
 
-		// Runs must be monotonically increasing by 1
-		if( tile.getNumber() != number ) {
+		// Runs must be monotonically increasing by 1, with jokers filling any gaps
+		if( tile.getNumber() < number || tile.getNumber() - number > static_cast<int>( jokers ) ) {
 			return false;
 		}
 
-		number++;
+		jokers -= tile.getNumber() - number;
+		number = tile.getNumber() + 1;
 	}
 
+	// Leftover jokers extend the run; it has tiles.size() numbers, which fit in 1..13
 	return true;
 }
-
@@ -21,6 +21,15 @@
 #include "SetFinder.hpp"      // Original include
 #include "MoveFinder.hpp"     // Added for new tests
 #include "GameTypes.hpp"      // Added for Move struct, Tile, etc. (Board.hpp also includes it)
+#include "Analyzer.hpp"
+#include "Game.hpp"
+#include "Tournament.hpp"
+#include "Benchmark.hpp"
+#include "Arena.hpp"
+#include "ExactCover.hpp"
+#ifdef ENABLE_ALLOCATION_TRACKING
+#include "AllocationHook.hpp"
+#endif
 
 #include <cassert>
 #include <iostream>
@@ -28,6 +37,14 @@
 #include <vector>    // For std::vector
 #include <set>       // For std::set in test comparisons (already used by Board.hpp)
 #include <optional>  // For std::optional (already used by Board.hpp)
+#include <random>    // For std::mt19937 in randomized cross-checks
+#include <type_traits> // For std::is_trivially_copyable_v
+#include <cmath>     // For std::abs
+#include <limits>    // For std::numeric_limits
+#include <stdexcept> // For exceptions thrown through ThreadPool::parallel_for
+#include <cstring>   // For std::strcmp
+#include <unistd.h>  // For fork, execv
+#include <sys/wait.h> // For waitpid
 
 
 // Existing global variable
@@ -82,6 +99,40 @@ bool areBoardStatesEquivalent(BoardState bs1, BoardState bs2, bool verbose = fal
 }
 
 
+void testTileEncoding() {
+    TRACE_FUNCTION();
+    std::cout << "\n--- Testing packed Tile encoding ---" << std::endl;
+
+    static_assert(sizeof(Tile) == 1, "Tile should be one byte");
+    static_assert(Tile(1, blue).getCode() == 0 && Tile(13, yellow, 1).getCode() == 103, "code layout");
+    static_assert(Tile(7, red, 1).getNumber() == 7 && Tile(7, red, 1).getColor() == red, "round trip");
+
+    for (const auto& tile : allTiles) {
+        Tile rebuilt(tile.getNumber(), tile.getColor(), tile.getCopy());
+        assert(rebuilt == tile && TileCode::isPlayableKind(tile.getKind()));
+    }
+
+    Tile r5(5, red), r5_copy(5, red, 1), b9(9, blue), off_color(5, 0);
+    assert(r5 != r5_copy && r5.sameKind(r5_copy) && r5_copy.firstCopy() == r5);
+    assert(b9 < r5 && r5 < r5_copy); // color, then number, then copy
+    assert(off_color.getNumber() == 5 && off_color.getColor() == 0 && !TileCode::isPlayableKind(off_color.getKind()));
+
+    // Out-of-range numbers must not alias the joker or a neighbouring row, and no set takes them.
+    for (Tile bad : {Tile(14, yellow), Tile(0, red), Tile(-1, blue, 1), Tile(200, purple)}) {
+        assert(bad.getKind() == TileCode::INVALID_KIND && !bad.isJoker() && bad.getNumber() == 0);
+    }
+    assert(Tile(0, red) != Tile(13, purple) && Tile(14, yellow) != Tile::joker());
+    assert(!SetValidator::is_valid(SetValidator::encode(std::vector<Tile>{Tile(12, red), Tile(13, red), Tile(14, red)}, SetType::RUN)));
+
+    std::vector<Tile> deck = allTiles;
+    std::sort(deck.begin(), deck.end());
+    for (size_t i = 1; i < deck.size(); ++i) {
+        assert(deck[i - 1].getCode() + 1 == deck[i].getCode());
+    }
+
+    std::cout << "--- Packed Tile encoding Tests Passed ---" << std::endl;
+}
+
 void testBoardStructures() {
     TRACE_FUNCTION(); // Added TRACE_FUNCTION
     std::cout << "\n--- Testing Board Structures ---" << std::endl;
@@ -133,6 +184,61 @@ void testBoardStructures() {
     std::cout << "--- Board Structures Tests Passed ---" << std::endl;
 }
 
+void testGameSetLayout() {
+    TRACE_FUNCTION();
+    std::cout << "\n--- Testing GameSet layout ---" << std::endl;
+
+    // TC1: Sets hold their tiles inline and copy as plain bytes.
+    static_assert(std::is_trivially_copyable_v<GameSet> && sizeof(GameSet) == 15);
+    GameSet run({Tile(5, blue), Tile(3, blue), Tile(4, blue)}, SetType::RUN);
+    GameSet copy = run;
+    assert(copy == run && copy.tiles.size() == 3 && copy.tiles[0] == Tile(3, blue) && copy.tiles.back() == Tile(5, blue));
+    std::cout << "TC1 Inline tiles: Passed" << std::endl;
+
+    // TC2: Word-wise equality and ordering agree with comparing (type, sorted tiles) vectors,
+    // including prefixes, duplicate tiles and jokers.
+    std::mt19937 rng(19);
+    std::vector<Tile> pool = allTiles;
+    pool.push_back(Tile::joker(0));
+    pool.push_back(Tile::joker(1));
+    std::vector<std::pair<GameSet, std::vector<Tile>>> samples;
+    for (int i = 0; i < 400; ++i) {
+        std::vector<Tile> tiles;
+        size_t size = rng() % (SetTiles::CAPACITY + 1);
+        Tile first = pool[rng() % 8]; // Few distinct low tiles, so prefixes and ties are common.
+        for (size_t k = 0; k < size; ++k) {
+            tiles.push_back(k == 0 || rng() % 2 ? first : pool[rng() % pool.size()]);
+        }
+        SetType type = rng() % 2 ? SetType::RUN : SetType::GROUP;
+        GameSet set(tiles, type);
+        std::sort(tiles.begin(), tiles.end());
+        assert(std::equal(set.tiles.begin(), set.tiles.end(), tiles.begin(), tiles.end()));
+        samples.push_back({set, tiles});
+    }
+    for (const auto& a : samples) {
+        for (const auto& b : samples) {
+            bool vector_less = a.first.type != b.first.type ? a.first.type < b.first.type : a.second < b.second;
+            bool vector_equal = a.first.type == b.first.type && a.second == b.second;
+            assert((a.first < b.first) == vector_less);
+            assert((a.first == b.first) == vector_equal);
+        }
+    }
+    std::cout << "TC2 Ordering matches tile vectors: Passed" << std::endl;
+
+    // TC3: More tiles than any set can hold leave an empty, invalid set.
+    std::vector<Tile> too_long;
+    for (int number = 1; number <= TileCode::NUM_NUMBERS; ++number) {
+        too_long.push_back(Tile(number, red));
+    }
+    assert(GameSet(too_long, SetType::RUN).isValid());
+    too_long.push_back(Tile::joker(0));
+    GameSet overflow(too_long, SetType::RUN);
+    assert(overflow.tiles.empty() && !overflow.isValid());
+    std::cout << "TC3 Oversized set: Passed" << std::endl;
+
+    std::cout << "--- GameSet layout Tests Passed ---" << std::endl;
+}
+
 void testSetFinder() {
     TRACE_FUNCTION(); // Added TRACE_FUNCTION
     std::cout << "\n--- Testing SetFinder ---" << std::endl;
@@ -209,6 +315,32 @@ void testSetFinder() {
     assert(areGameSetVectorsEqual("TC8 Two Tiles", tc8_actual, tc8_expected, true));
     std::cout << "TC8 Two Tiles: Passed" << std::endl;
 
+    std::vector<GameSet> tc9_actual = SetFinder::find_all_possible_sets(allTiles);
+    assert(tc9_actual.size() == static_cast<size_t>(SetFinder::CATALOG_SIZE));
+    assert(std::is_sorted(tc9_actual.begin(), tc9_actual.end()));
+    assert(std::adjacent_find(tc9_actual.begin(), tc9_actual.end()) == tc9_actual.end());
+    assert(std::all_of(tc9_actual.begin(), tc9_actual.end(), [](const GameSet& set) { return set.isValid(); }));
+    assert(SetFinder::findAllValidRuns(allTiles).size() == static_cast<size_t>(SetFinder::NUM_CATALOG_RUNS));
+    assert(SetFinder::findAllValidGroups(allTiles).size() == static_cast<size_t>(SetFinder::NUM_CATALOG_GROUPS));
+    std::cout << "TC9 Full deck matches catalog: Passed" << std::endl;
+
+    // TC10: The kind index lists exactly the catalog sets holding each kind, in order.
+    size_t memberships = 0;
+    for (int kind = 0; kind < TileCode::NUM_KINDS; ++kind) {
+        std::vector<uint16_t> expected;
+        for (int i = 0; i < SetFinder::CATALOG_SIZE; ++i) {
+            if (SetFinder::CATALOG[i].mask & TileCode::kindBit(kind)) {
+                expected.push_back(static_cast<uint16_t>(i));
+            }
+        }
+        SetFinder::CatalogRange range = SetFinder::sets_containing(kind);
+        assert(std::vector<uint16_t>(range.begin(), range.end()) == expected);
+        memberships += range.size();
+    }
+    assert(memberships == static_cast<size_t>(SetFinder::NUM_CATALOG_MEMBERSHIPS));
+    assert(SetFinder::sets_containing(Tile::joker(0).getKind()).empty());
+    std::cout << "TC10 Kind index matches catalog: Passed" << std::endl;
+
     std::cout << "--- SetFinder Tests Passed ---" << std::endl;
 }
 
@@ -274,6 +406,86 @@ void testIsBoardValidFunction() { // This is the original testIsBoardValidFuncti
     std::cout << "--- is_board_valid (free function) Tests Passed ---" << std::endl;
 }
 
+void testBoardStateEdits() {
+    TRACE_FUNCTION();
+    std::cout << "\n--- Testing BoardState edits ---" << std::endl;
+
+    Tile r1(1,red), r2(2,red), r3(3,red), r4(4,red);
+    GameSet valid_run({r1,r2,r3}, SetType::RUN);
+    GameSet group_with_r1({r1, Tile(1,blue), Tile(1,yellow)}, SetType::GROUP);
+    GameSet group_of_fives({Tile(5,red), Tile(5,blue), Tile(5,purple)}, SetType::GROUP);
+    GameSet invalid_run({r1,r3,r4}, SetType::RUN);
+
+    BoardState board({valid_run, group_of_fives});
+    board.replaceSet(1, group_with_r1);
+    assert(!board.isValidBoard());
+    board.replaceSet(1, group_of_fives);
+    assert(board.isValidBoard()); std::cout << "TC1 Replace introduces and removes a duplicate: Passed" << std::endl;
+
+    board.replaceSet(0, invalid_run);
+    assert(!board.isValidBoard());
+    board.removeSet(0);
+    assert(board.isValidBoard() && board.sets.size() == 1 && board.sets[0] == group_of_fives);
+    std::cout << "TC2 Remove an invalid set: Passed" << std::endl;
+
+    // Random edits from catalog sets, both copies of each tile in play; the tracked validity
+    // and hashes must match a board rebuilt from scratch after every edit.
+    std::mt19937_64 rng(21);
+    auto random_set = [&rng]() {
+        const SetFinder::CatalogEntry& entry = SetFinder::CATALOG[rng() % SetFinder::CATALOG_SIZE];
+        std::vector<Tile> tiles;
+        for (TileCode::KindMask rest = entry.mask; rest != 0; rest &= rest - 1) {
+            tiles.push_back(Tile::fromCode(static_cast<uint8_t>(__builtin_ctzll(rest) * 2 + rng() % 2)));
+        }
+        if (rng() % 8 == 0) { // Now and then a set that breaks the rules.
+            tiles.pop_back();
+        }
+        return GameSet(tiles, entry.type);
+    };
+    BoardState edited;
+    int valid_boards = 0;
+    for (int step = 0; step < 2000; ++step) {
+        size_t op = rng() % 3;
+        if (op == 0 || edited.sets.empty()) {
+            edited.addSet(random_set());
+        } else if (op == 1) {
+            edited.replaceSet(rng() % edited.sets.size(), random_set());
+        } else {
+            edited.removeSet(rng() % edited.sets.size());
+        }
+        if (edited.sets.size() > 6) {
+            edited.removeSet(0);
+        }
+        BoardState rebuilt(edited.sets);
+        assert(edited.isValidBoard() == is_board_valid(edited.sets));
+        assert(edited.isValidBoard() == rebuilt.isValidBoard());
+        assert(edited.tileHash() == rebuilt.tileHash() && edited.structureHash() == rebuilt.structureHash());
+        valid_boards += edited.isValidBoard();
+    }
+    assert(valid_boards > 0 && valid_boards < 2000);
+    std::cout << "TC3 Random edits match a rebuilt board: Passed" << std::endl;
+
+    // TC4: A board copies as plain bytes (no allocation, counted with ALLOC=1), and one given
+    // more sets than any valid board holds keeps the first ones and is invalid.
+    std::mt19937_64 sample_rng(19);
+    Benchmark::Position full = Benchmark::random_position(90, 0, sample_rng);
+    uint64_t copy_allocations = PerformanceTracer::thread_allocations.count;
+    BoardState copy = full.board;
+    BoardState assigned;
+    assigned = copy;
+    assert(PerformanceTracer::thread_allocations.count == copy_allocations);
+    assert(assigned == full.board && assigned.isValidBoard() && assigned.tileHash() == full.board.tileHash());
+    std::vector<GameSet> too_many(BoardSets::CAPACITY + 1, GameSet({Tile(1, red), Tile(2, red), Tile(3, red)}, SetType::RUN));
+    BoardState overflowed(too_many);
+    assert(overflowed.sets.size() == BoardSets::CAPACITY && overflowed.sets.overflowed() && !overflowed.isValidBoard());
+    overflowed.sets.clear();
+    overflowed.rehash();
+    assert(overflowed.isValidBoard());
+    std::cout << "TC4 Flat copies and set capacity: Passed" << std::endl;
+
+    std::cout << "--- BoardState edits Tests Passed ---" << std::endl;
+}
+
 void testCanAddTilesToBoard() { // This is the original, now updated for std::optional
     TRACE_FUNCTION();
     std::cout << "\n--- Testing can_add_tiles_to_board ---" << std::endl;
@@ -426,6 +638,1123 @@ void testCanAddTilesToBoard() { // This is the original, now updated for std::op
     std::cout << "--- can_add_tiles_to_board (Heavyweight Cases) Tests Passed ---" << std::endl;
 }
 
+void testZobrist() {
+    TRACE_FUNCTION();
+    std::cout << "\n--- Testing Zobrist hashing ---" << std::endl;
+
+    // Incremental updates match hashing from scratch, and make/unmake restores the hash.
+    Zobrist::PoolHash pool;
+    std::vector<Tile> tiles;
+    for (size_t i = 0; i < allTiles.size(); i += 3) {
+        pool.add(allTiles[i]);
+        tiles.push_back(allTiles[i]);
+        assert(pool.value() == Zobrist::hash_tiles(tiles));
+    }
+    uint64_t before = pool.value();
+    pool.remove(tiles[4]);
+    pool.remove(tiles[7]);
+    assert(pool.value() != before);
+    pool.add(tiles[7]);
+    pool.add(tiles[4]);
+    assert(pool.value() == before);
+    assert(Zobrist::hash_tiles({Tile(3,red), Tile(3,red,1)}) != Zobrist::hash_tiles({Tile(3,red)}));
+    std::cout << "TC1 Incremental pool hash: Passed" << std::endl;
+
+    // Board hashes ignore set order, follow addSet, and separate tile kinds from structure.
+    GameSet run({Tile(1,red), Tile(2,red), Tile(3,red), Tile(4,red)}, SetType::RUN);
+    GameSet group({Tile(5,red), Tile(5,blue), Tile(5,yellow)}, SetType::GROUP);
+    GameSet short_run({Tile(1,red), Tile(2,red), Tile(3,red)}, SetType::RUN);
+    GameSet long_run({Tile(4,red), Tile(5,red), Tile(6,red)}, SetType::RUN);
+    GameSet other_group({Tile(5,blue), Tile(5,yellow), Tile(5,purple)}, SetType::GROUP);
+    BoardState incremental;
+    incremental.addSet(run);
+    incremental.addSet(group);
+    BoardState reversed(std::vector<GameSet>{group, run});
+    assert(incremental.tileHash() == reversed.tileHash() && incremental.structureHash() == reversed.structureHash());
+    assert(incremental.tileHash() == Zobrist::hash_tiles(incremental.getAllTiles()));
+    BoardState split(std::vector<GameSet>{short_run, long_run});
+    BoardState joined(std::vector<GameSet>{GameSet({Tile(1,red), Tile(2,red), Tile(3,red), Tile(4,red), Tile(5,red), Tile(6,red)}, SetType::RUN)});
+    assert(split.tileHash() == joined.tileHash() && split.structureHash() != joined.structureHash());
+    BoardState different(std::vector<GameSet>{run, other_group});
+    assert(incremental.structureHash() != different.structureHash());
+    assert(incremental.tileHash() != different.tileHash());
+    std::cout << "TC2 Board tile and structure hashes: Passed" << std::endl;
+
+    std::cout << "--- Zobrist hashing Tests Passed ---" << std::endl;
+}
+
+void testExactCover() {
+    TRACE_FUNCTION();
+    std::cout << "\n--- Testing ExactCover ---" << std::endl;
+
+    Tile r1(1,red), r2(2,red), r3(3,red), r4(4,red), r5(5,red), r6(6,red);
+    std::optional<std::vector<GameSet>> run = ExactCover::solve({r1,r2,r3,Tile(1,red,1),Tile(2,red,1),Tile(3,red,1)});
+    assert(run && run->size() == 2 && BoardState(*run).isValidBoard());
+    assert(!ExactCover::solve({r1,r2,r4}));
+    std::cout << "TC1 First arrangement and none: Passed" << std::endl;
+
+    // 1-6 of one color is either one run or two runs of three.
+    std::vector<std::vector<GameSet>> all;
+    uint64_t count = ExactCover::for_each_arrangement({r1,r2,r3,r4,r5,r6}, [&all](const std::vector<GameSet>& arrangement) {
+        all.push_back(arrangement);
+        return true;
+    });
+    assert(count == 2 && all.size() == 2 && all[0] != all[1]);
+    std::cout << "TC2 Enumerates each arrangement once: Passed" << std::endl;
+
+    // A joker stands in for the tile a set is missing; two jokers can complete one real tile.
+    Tile J0 = Tile::joker(0), J1 = Tile::joker(1);
+    std::optional<std::vector<GameSet>> with_joker = ExactCover::solve({r1,r2,r3,J0});
+    assert(with_joker && with_joker->size() == 1 && BoardState(*with_joker).isValidBoard());
+    assert(sorted(BoardState(*with_joker).getAllTiles()) == sorted({r1,r2,r3,J0}));
+    assert(ExactCover::for_each_arrangement({r1,r2,r3,J0}, [](const std::vector<GameSet>&) { return true; }) == 1);
+    assert(ExactCover::solve({r1,J0,J1}) && !ExactCover::solve({r1,J0}) && !ExactCover::solve({r1,r4,J0}));
+    assert(ExactCover::for_each_arrangement({r1,r4,J0}, [](const std::vector<GameSet>&) { return true; }) == 0);
+
+    // Jokers stand in for every color, yellow (the last) included, and small joker pools
+    // arrange exactly when the DP says so.
+    std::vector<std::vector<Tile>> joker_pools = {
+        {Tile(4,purple), Tile(4,red,1), J0, J1},
+        {Tile(10,blue), Tile(10,red), J0, J1},
+        {Tile(3,purple), Tile(3,red,1), J0, J1},
+        {Tile(5,purple), Tile(3,blue,1), Tile(3,purple), Tile(5,blue,1), Tile(5,red), J0, J1},
+        {Tile(7,blue), Tile(7,purple), Tile(7,red), J0},
+    };
+    std::mt19937_64 joker_rng(31);
+    for (int i = 0; i < 300; ++i) {
+        std::vector<Tile> deck = allTiles;
+        std::shuffle(deck.begin(), deck.end(), joker_rng);
+        std::vector<Tile> pool(deck.begin(), deck.begin() + 2 + i % 6);
+        pool.push_back(J0);
+        if (i % 2 == 0) {
+            pool.push_back(J1);
+        }
+        joker_pools.push_back(pool);
+    }
+    for (const auto& pool : joker_pools) {
+        std::optional<std::vector<GameSet>> arrangement = ExactCover::solve(pool);
+        assert(arrangement.has_value() == ArrangementSolver::is_arrangeable(pool));
+        if (arrangement) {
+            BoardState board(*arrangement);
+            assert(board.isValidBoard() && sorted(board.getAllTiles()) == sorted(pool));
+        }
+    }
+    for (size_t i = 0; i < 5; ++i) {
+        assert(ExactCover::solve(joker_pools[i]));
+    }
+    std::cout << "TC3 Jokers: Passed" << std::endl;
+
+    // Agrees with the DP on random pools, with and without jokers, and branches far less
+    // than the reference backtracker.
+    std::mt19937_64 rng(23);
+    uint64_t dlx_nodes = 0;
+    uint64_t reference_nodes = 0;
+    for (int iteration = 0; iteration < 60; ++iteration) {
+        bool small = iteration < 20;
+        Benchmark::Position position = Benchmark::random_position(small ? 12 : 60 + iteration % 40, 3, rng);
+        std::vector<Tile> pool = position.board.getAllTiles();
+        pool.insert(pool.end(), position.hand.begin(), position.hand.end());
+        if (iteration >= 40) {
+            pool.push_back(J0);
+            if (iteration % 2 == 0) {
+                pool.push_back(J1);
+            }
+        }
+        uint64_t nodes = 0;
+        std::optional<std::vector<GameSet>> arrangement = ExactCover::solve(pool, &nodes);
+        assert(arrangement.has_value() == ArrangementSolver::is_arrangeable(pool));
+        if (arrangement) {
+            BoardState board(*arrangement);
+            assert(board.isValidBoard() && sorted(board.getAllTiles()) == sorted(pool));
+        }
+        if (small) {
+            TranspositionTable table;
+            BoardManipulation::can_add_tiles_to_board_reference(position.board, position.hand, &table);
+            dlx_nodes += nodes;
+            reference_nodes += table.stats().hits + table.stats().misses;
+        }
+    }
+    assert(dlx_nodes * 5 < reference_nodes);
+    std::cout << "TC4 Matches the DP; " << dlx_nodes << " nodes against the reference's " << reference_nodes << ": Passed" << std::endl;
+
+    std::cout << "--- ExactCover Tests Passed ---" << std::endl;
+}
+
+void testThreadPool() {
+    TRACE_FUNCTION();
+    std::cout << "\n--- Testing ThreadPool ---" << std::endl;
+
+    ThreadPool pool(3);
+    assert(pool.size() == 3);
+    std::vector<int> hits(10007, 0);
+    std::atomic<long long> sum{0};
+    pool.parallel_for(hits.size(), 13, [&](size_t i) {
+        hits[i]++;
+        sum += static_cast<long long>(i);
+    });
+    assert(std::all_of(hits.begin(), hits.end(), [](int h) { return h == 1; }));
+    assert(sum == 10006LL * 10007LL / 2);
+    std::cout << "TC1 Every index runs exactly once: Passed" << std::endl;
+
+    // Nested loops: the calling task helps instead of blocking a worker.
+    std::atomic<int> inner{0};
+    pool.parallel_for(6, 1, [&](size_t) {
+        pool.parallel_for(50, 4, [&](size_t) { inner++; });
+    });
+    assert(inner == 300);
+    std::cout << "TC2 Nested parallel_for: Passed" << std::endl;
+
+    // A pool of N threads is N - 1 workers plus the caller, so a loop never runs on more
+    // than N threads.
+    for (size_t threads : {1, 2, 4}) {
+        ThreadPool sized(threads);
+        std::mutex ids_mutex;
+        std::set<std::thread::id> ids;
+        sized.parallel_for(400, 1, [&](size_t) {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+            std::lock_guard<std::mutex> lock(ids_mutex);
+            ids.insert(std::this_thread::get_id());
+        });
+        assert(sized.size() == threads && ids.size() <= threads);
+    }
+    std::cout << "TC3 size() counts the calling thread: Passed" << std::endl;
+
+    // Cancelling stops the loop: nothing close to the 10^9 indices is claimed.
+    std::atomic<bool> cancel{false};
+    std::atomic<size_t> ran{0};
+    pool.parallel_for(1000000000, 1, [&](size_t i) {
+        ran++;
+        if (i >= 100) {
+            cancel = true;
+        }
+    }, &cancel);
+    assert(ran >= 101 && ran < 10000);
+    std::cout << "TC4 Cancelled loop stops claiming chunks: Passed" << std::endl;
+
+    // An exception thrown by the body reaches the caller instead of a worker.
+    bool caught = false;
+    try {
+        pool.parallel_for(1000, 3, [&](size_t i) {
+            if (i == 517) {
+                throw std::runtime_error("body failed");
+            }
+        });
+    } catch (const std::runtime_error& error) {
+        caught = std::string(error.what()) == "body failed";
+    }
+    assert(caught);
+    std::atomic<int> after{0};
+    pool.parallel_for(100, 1, [&](size_t) { after++; });
+    assert(after == 100);
+    std::cout << "TC5 Exceptions are rethrown in the caller: Passed" << std::endl;
+
+    std::cout << "--- ThreadPool Tests Passed ---" << std::endl;
+}
+
+void testAnalyzer() {
+    TRACE_FUNCTION();
+    std::cout << "\n--- Testing Analyzer ---" << std::endl;
+
+    for (const auto& tile : allTiles) {
+        std::optional<Tile> parsed = Tile::fromString(tile.toString());
+        assert(parsed.has_value() && *parsed == tile);
+    }
+    assert(Tile(13, blue, 1).toString() == "B13'");
+    assert(!Tile::fromString("R14") && !Tile::fromString("G3") && !Tile::fromString("R") && !Tile::fromString("R1x"));
+    std::cout << "TC1 Tile text round trip: Passed" << std::endl;
+
+    std::string error;
+    std::optional<Analyzer::Position> position = Analyzer::parse_position("R1 R2 R3 | B4 R4 Y4 ; R5 Y12 Y10 Y11", error);
+    assert(position.has_value() && position->board.sets.size() == 2 && position->hand.size() == 4);
+    assert(position->board.sets[0].type == SetType::RUN && position->board.sets[1].type == SetType::GROUP);
+    assert(Analyzer::format_board(position->board) == "R1 R2 R3 | B4 R4 Y4");
+    assert(!Analyzer::parse_position("R1 R2 R3", error) && error.find("';'") != std::string::npos);
+    std::cout << "TC2 Position parsing: Passed" << std::endl;
+
+    // Output stays in input order across threads and batches, with errors reported inline.
+    std::ostringstream input;
+    input << "# board ; hand\n";
+    for (int i = 0; i < 25; ++i) {
+        input << (i % 5 == 4 ? "R1 Q2 ; R3" : "B1 B2 B3 ; B4 B5 P5 R5") << "\n";
+    }
+    std::istringstream in(input.str());
+    std::ostringstream out;
+    ThreadPool two_threads(2);
+    assert(Analyzer::run(in, out, two_threads, 7) == 25);
+    std::istringstream lines(out.str());
+    std::string line;
+    int row = 0;
+    while (std::getline(lines, line)) {
+        std::istringstream fields(line);
+        std::string line_number, played;
+        std::getline(fields, line_number, '\t');
+        std::getline(fields, played, '\t');
+        assert(line_number == std::to_string(row + 2));
+        assert(played == (row % 5 == 4 ? "error" : "4"));
+        ++row;
+    }
+    assert(row == 25);
+    std::cout << "TC3 Ordered batch output: Passed" << std::endl;
+
+    std::cout << "--- Analyzer Tests Passed ---" << std::endl;
+}
+
+void testGame() {
+    TRACE_FUNCTION();
+    std::cout << "\n--- Testing Game ---" << std::endl;
+
+    std::vector<Tile> deck = allTiles;
+    deck.push_back(Tile::joker(0));
+    deck.push_back(Tile::joker(1));
+    std::sort(deck.begin(), deck.end());
+
+    // Every tile is in exactly one place, the board stays valid and each turn follows the rules.
+    for (int players = Game::MIN_PLAYERS; players <= Game::MAX_PLAYERS; ++players) {
+        Game::Config config;
+        config.players = players;
+        Game game(config);
+        assert(game.deck().size() == deck.size());
+        game.deal(11 + players);
+        while (!game.is_over()) {
+            int player = game.current_player();
+            bool melded = game.has_melded(player);
+            size_t hand_size = game.hand(player).size();
+            size_t pile_size = game.pile().size();
+            BoardState before = game.board();
+
+            TurnRecord turn = game.play_turn();
+            assert(turn.player == player);
+            assert(game.board().isValidBoard());
+
+            std::vector<Tile> board_tiles = game.board().getAllTiles();
+            std::vector<Tile> everything = game.pile();
+            everything.insert(everything.end(), board_tiles.begin(), board_tiles.end());
+            for (int p = 0; p < players; ++p) {
+                everything.insert(everything.end(), game.hand(p).begin(), game.hand(p).end());
+            }
+            std::sort(everything.begin(), everything.end());
+            assert(everything == deck);
+
+            switch (turn.action) {
+            case TurnAction::MELD: {
+                // Hand-only sets worth the threshold are appended; the board is untouched.
+                assert(!melded && game.has_melded(player));
+                assert(std::equal(before.sets.begin(), before.sets.end(), game.board().sets.begin()));
+                std::vector<Tile> laid;
+                for (size_t i = before.sets.size(); i < game.board().sets.size(); ++i) {
+                    laid.insert(laid.end(), game.board().sets[i].tiles.begin(), game.board().sets[i].tiles.end());
+                }
+                assert(static_cast<int>(laid.size()) == turn.tiles_played);
+                assert(Game::points(laid) >= Game::INITIAL_MELD_POINTS);
+                assert(game.hand(player).size() == hand_size - laid.size());
+                break;
+            }
+            case TurnAction::PLAY:
+                assert(melded && turn.tiles_played > 0);
+                assert(game.hand(player).size() == hand_size - turn.tiles_played);
+                break;
+            case TurnAction::DRAW:
+                assert(game.hand(player).size() == hand_size + 1 && game.pile().size() == pile_size - 1);
+                assert(game.board() == before);
+                break;
+            case TurnAction::PASS:
+                assert(pile_size == 0 && game.hand(player).size() == hand_size);
+                break;
+            }
+            assert(std::is_sorted(game.hand(player).begin(), game.hand(player).end()));
+        }
+
+        const Game::Result& result = game.result();
+        assert(result.winner >= 0 && result.winner < players);
+        assert(result.blocked || game.hand(result.winner).empty());
+        int total = 0;
+        for (int p = 0; p < players; ++p) {
+            assert(result.hand_points[p] == Game::points(game.hand(p)));
+            assert(result.hand_points[p] >= result.hand_points[result.winner] || !result.blocked);
+            total += result.scores[p];
+        }
+        assert(total == 0 && result.scores[result.winner] >= 0);
+    }
+    std::cout << "TC1 Rules and tile conservation (2-4 players): Passed" << std::endl;
+
+    // A seed fully determines a game, also when a Game object is reused.
+    Game first, second;
+    Game::Result replayed = first.play(7);
+    second.play(8);
+    const Game::Result& again = second.play(7);
+    assert(replayed.turns == again.turns && replayed.winner == again.winner && replayed.scores == again.scores);
+    assert(first.board() == second.board());
+    std::cout << "TC2 Deterministic replay: Passed" << std::endl;
+
+    Game::Config too_many;
+    too_many.players = 9;
+    assert(Game(too_many).players() == Game::MAX_PLAYERS);
+    Game::Config short_game;
+    short_game.max_turns = 3;
+    Game capped(short_game);
+    assert(capped.play(1).turns == 3 && capped.result().blocked);
+    std::cout << "TC3 Config limits: Passed" << std::endl;
+
+    // play_best_move is find_best_move(board, hand, false) applied in place.
+    std::mt19937_64 position_rng(909);
+    std::vector<GameSet> spare_sets;
+    for (int iteration = 0; iteration < 40; ++iteration) {
+        Benchmark::Position position = Benchmark::random_position(3 * iteration, 1 + iteration % 15, position_rng);
+        std::optional<Move> expected = MoveFinder::find_best_move(position.board, position.hand, false);
+        BoardState board = position.board;
+        std::vector<Tile> hand = position.hand;
+        int played = MoveFinder::play_best_move(board, hand, spare_sets);
+        assert(played == (expected ? expected->tiles_played_count : 0));
+        if (expected) {
+            assert(board == expected->new_board_state && hand == expected->remaining_hand);
+        } else {
+            assert(board == position.board && hand == position.hand);
+        }
+    }
+    std::cout << "TC4 play_best_move matches find_best_move: Passed" << std::endl;
+
+    // Once a Game has played, its turns allocate nothing (counted with ALLOC=1).
+    Game steady;
+    steady.play(3);
+    uint64_t turns = 0;
+    uint64_t allocations_before = PerformanceTracer::thread_allocations.count;
+    for (uint64_t seed = 4; seed < 8; ++seed) {
+        steady.deal(seed);
+        while (!steady.is_over()) {
+            steady.play_turn();
+            ++turns;
+        }
+    }
+    uint64_t turn_allocations = PerformanceTracer::thread_allocations.count - allocations_before;
+    assert(turn_allocations == 0);
+    std::cout << "TC5 No allocations over " << turns << " turns (hook "
+              << (PerformanceTracer::allocation_hook_installed ? "installed" : "not installed") << "): Passed" << std::endl;
+
+    std::cout << "--- Game Tests Passed ---" << std::endl;
+}
+
+void testTournament() {
+    TRACE_FUNCTION();
+    std::cout << "\n--- Testing Tournament ---" << std::endl;
+
+    std::mt19937_64 rng_a(42), rng_b(42);
+    std::vector<Tile> order_a = allTiles, order_b = allTiles;
+    shuffle(&order_a, rng_a);
+    shuffle(&order_b, rng_b);
+    assert(order_a == order_b && order_a != allTiles);
+    std::sort(order_a.begin(), order_a.end());
+    std::vector<Tile> sorted_tiles = allTiles;
+    std::sort(sorted_tiles.begin(), sorted_tiles.end());
+    assert(order_a == sorted_tiles);
+    std::cout << "TC1 Seeded shuffle: Passed" << std::endl;
+
+    std::set<uint64_t> seeds;
+    for (uint64_t i = 0; i < 1000; ++i) {
+        seeds.insert(Tournament::game_seed(3, i));
+    }
+    assert(seeds.size() == 1000 && Tournament::game_seed(3, 0) != Tournament::game_seed(4, 0));
+    std::cout << "TC2 Per-game seeds: Passed" << std::endl;
+
+    // Totals are independent of the thread count, and every game can be replayed alone.
+    Game::Config config;
+    config.players = 3;
+    const uint64_t games = 10;
+    ThreadPool one_thread(1), three_threads(3);
+    Tournament::Summary serial = Tournament::run(games, config, 99, one_thread);
+    Tournament::Summary parallel = Tournament::run(games, config, 99, three_threads);
+    assert(serial.tally.games == games && parallel.tally.games == games);
+    assert(serial.tally.turns == parallel.tally.turns && serial.tally.wins == parallel.tally.wins);
+    assert(serial.tally.scores == parallel.tally.scores && serial.tally.blocked == parallel.tally.blocked);
+    assert(serial.threads == 1 && serial.threads_used == 1);
+    assert(parallel.threads == 3 && parallel.threads_used >= 1 && parallel.threads_used <= 3);
+
+    Tournament::Tally replayed;
+    Game game(config);
+    for (uint64_t i = 0; i < games; ++i) {
+        replayed.add(Tournament::replay(game, 99, i));
+    }
+    assert(replayed.turns == serial.tally.turns && replayed.wins == serial.tally.wins);
+    double rates = 0;
+    for (int p = 0; p < config.players; ++p) {
+        rates += serial.win_rate(p);
+    }
+    assert(rates > 0.999 && rates < 1.001);
+    std::cout << "TC3 Thread-independent totals and replay: Passed" << std::endl;
+
+    std::cout << "--- Tournament Tests Passed ---" << std::endl;
+}
+
+void testSetValidator() {
+    TRACE_FUNCTION();
+    std::cout << "\n--- Testing SetValidator ---" << std::endl;
+
+    // TC1: The mask rules agree with isValidRun / isValidGroup on random tile lists, with
+    // jokers, repeated kinds and lengths past the largest set.
+    std::mt19937 rng(20);
+    std::vector<Tile> pool = allTiles;
+    pool.push_back(Tile::joker(0));
+    pool.push_back(Tile::joker(1));
+    std::vector<std::pair<std::vector<Tile>, SetType>> samples;
+    for (int i = 0; i < 20000; ++i) {
+        SetType type = i % 2 ? SetType::RUN : SetType::GROUP;
+        size_t size = 1 + rng() % (type == SetType::RUN ? 14 : 5);
+        // Tiles near one anchor (same color or same number) so that valid sets are common.
+        Tile anchor = pool[rng() % allTiles.size()];
+        std::vector<Tile> tiles;
+        for (size_t k = 0; k < size; ++k) {
+            int pick = rng() % 8;
+            if (pick == 0) {
+                tiles.push_back(Tile::joker(rng() % 2));
+            } else if (pick == 1) {
+                tiles.push_back(pool[rng() % pool.size()]);
+            } else if (type == SetType::RUN) {
+                int number = std::clamp(anchor.getNumber() + static_cast<int>(k) + static_cast<int>(rng() % 3) - 1, 1, 13);
+                tiles.push_back(Tile(number, anchor.getColor(), rng() % 2));
+            } else {
+                tiles.push_back(Tile(anchor.getNumber(), 1 + rng() % TileCode::NUM_COLORS, rng() % 2));
+            }
+        }
+        bool expected = type == SetType::RUN ? isValidRun(tiles) : isValidGroup(tiles);
+        assert(SetValidator::is_valid(SetValidator::encode(tiles, type)) == expected);
+        assert(GameSet(tiles, type).isValid() == (expected && size <= SetTiles::CAPACITY));
+        samples.push_back({tiles, type});
+    }
+    assert(!SetValidator::is_valid(SetValidator::encode(std::vector<Tile>{Tile(5, 0), Tile(6, 0), Tile(7, 0)}, SetType::RUN)));
+    // Tiles off the four colors or numbers outside 1..13 (which sort after the jokers) make
+    // a set invalid under both rules.
+    const std::vector<std::pair<std::vector<Tile>, SetType>> unplayable = {
+        {{Tile(1, red), Tile(2, red), Tile::joker(0), Tile(14, red)}, SetType::RUN},
+        {{Tile(1, 0), Tile(2, 0), Tile(3, 0)}, SetType::RUN},
+        {{Tile(0, blue), Tile(5, red), Tile(5, purple)}, SetType::GROUP},
+        {{Tile(5, 0), Tile(5, red), Tile(5, purple)}, SetType::GROUP},
+    };
+    for (const auto& [tiles, type] : unplayable) {
+        assert(!(type == SetType::RUN ? isValidRun(tiles) : isValidGroup(tiles)));
+        assert(!SetValidator::is_valid(SetValidator::encode(tiles, type)));
+    }
+    std::cout << "TC1 Mask rules match the validators: Passed" << std::endl;
+
+    // TC2: A batch's bitmap holds each set's validity, across several words.
+    SetValidator::Batch batch;
+    for (size_t i = 0; i < 150; ++i) {
+        batch.add(samples[i].first, samples[i].second);
+    }
+    std::vector<uint64_t> bitmap = batch.validate();
+    assert(bitmap.size() == 3);
+    size_t valid_count = 0;
+    for (size_t i = 0; i < 150; ++i) {
+        bool valid = (bitmap[i / 64] >> (i % 64)) & 1;
+        assert(valid == SetValidator::is_valid(SetValidator::encode(samples[i].first, samples[i].second)));
+        valid_count += valid;
+    }
+    assert(valid_count > 0 && valid_count < 150 && !batch.all_valid());
+    assert((bitmap[2] >> (150 - 128)) == 0); // Bits past the batch stay clear.
+    std::cout << "TC2 Validity bitmap (" << valid_count << "/150 valid): Passed" << std::endl;
+
+    // TC3: Physical tiles must be distinct across sets; the second copy of a kind is fine.
+    const Tile J = Tile::joker(0), J2 = Tile::joker(1);
+    std::vector<GameSet> copies = {GameSet({Tile(1, red), Tile(2, red), Tile(3, red)}, SetType::RUN),
+                                   GameSet({Tile(1, red, 1), Tile(1, blue), J}, SetType::GROUP)};
+    assert(is_board_valid(copies));
+    copies.push_back(GameSet({Tile(3, red), Tile(3, blue), Tile(3, yellow)}, SetType::GROUP));
+    assert(!is_board_valid(copies));
+    std::vector<GameSet> jokers = {GameSet({J, Tile(7, red), Tile(8, red)}, SetType::RUN),
+                                   GameSet({J, Tile(9, blue), Tile(9, red)}, SetType::GROUP)};
+    assert(!is_board_valid(jokers));
+    jokers[1] = GameSet({J2, Tile(9, blue), Tile(9, red)}, SetType::GROUP);
+    assert(is_board_valid(jokers));
+    assert(!is_board_valid({GameSet({J, J, Tile(9, blue), Tile(9, red)}, SetType::GROUP)}));
+
+    // Random boards, with one tile swapped for a random one, against a sort-based check.
+    std::mt19937_64 board_rng(21);
+    for (int i = 0; i < 300; ++i) {
+        Benchmark::Position position = Benchmark::random_position(80, 0, board_rng);
+        std::vector<GameSet> sets = position.board.sets;
+        if (i % 2) {
+            GameSet& victim = sets[board_rng() % sets.size()];
+            std::vector<Tile> tiles(victim.tiles);
+            tiles[board_rng() % tiles.size()] = pool[board_rng() % pool.size()];
+            victim = GameSet(tiles, victim.type);
+        }
+        std::vector<Tile> all;
+        bool sets_valid = true;
+        for (const auto& set : sets) {
+            std::vector<Tile> tiles(set.tiles);
+            sets_valid = sets_valid && (set.type == SetType::RUN ? isValidRun(tiles) : isValidGroup(tiles));
+            all.insert(all.end(), tiles.begin(), tiles.end());
+        }
+        std::sort(all.begin(), all.end());
+        bool expected = sets_valid && std::adjacent_find(all.begin(), all.end()) == all.end();
+        assert(is_board_valid(sets) == expected);
+    }
+    std::cout << "TC3 Board validity: Passed" << std::endl;
+
+    std::cout << "--- SetValidator Tests Passed ---" << std::endl;
+}
+
+void testJokers() {
+    TRACE_FUNCTION();
+    std::cout << "\n--- Testing Jokers ---" << std::endl;
+
+    const Tile J = Tile::joker(0), J2 = Tile::joker(1);
+    assert(J.isJoker() && J2.isJoker() && !J.sameKind(Tile(1, blue)) && J != J2);
+    assert(!TileCode::isPlayableKind(J.getKind()) && Tile(13, yellow, 1) < J);
+    assert(J.toString() == "J" && J2.toString() == "J'" && Tile::fromString("J'") == J2);
+    std::cout << "TC1 Joker tiles: Passed" << std::endl;
+
+    assert(isValidRun({Tile(3, red), J, Tile(5, red)}));
+    assert(isValidRun({Tile(12, red), Tile(13, red), J}));
+    assert(isValidRun({J, J2, Tile(13, red)}));
+    assert(isValidRun({Tile(1, blue), J, J2, Tile(4, blue), Tile(5, blue)}));
+    assert(!isValidRun({Tile(3, red), J, Tile(6, red)}));
+    assert(!isValidRun({Tile(3, red), Tile(4, blue), J}));
+    assert(!isValidRun({Tile(3, red), Tile(3, red, 1), J}));
+    assert(isValidGroup({Tile(5, red), Tile(5, blue), J}));
+    assert(isValidGroup({Tile(5, red), J, J2, Tile(5, blue)}));
+    assert(!isValidGroup({Tile(5, red), Tile(5, red, 1), J}));
+    assert(!isValidGroup({Tile(5, red), Tile(6, blue), J}));
+    assert(!isValidGroup({Tile(5, red), Tile(5, blue), Tile(5, yellow), Tile(5, purple), J}));
+    std::cout << "TC2 Joker runs and groups: Passed" << std::endl;
+
+    // The DP's wildcard slots agree with substituting every possible tile for each joker.
+    std::mt19937 rng(11);
+    auto by_substitution = [](std::vector<Tile> pool, int jokers) {
+        std::vector<int> counts(TileCode::NUM_KINDS, 0);
+        for (const auto& tile : pool) {
+            ++counts[tile.getKind()];
+        }
+        for (int a = 0; a < TileCode::NUM_KINDS; ++a) {
+            for (int b = (jokers == 2 ? a : TileCode::NUM_KINDS - 1); b < TileCode::NUM_KINDS; ++b) {
+                std::vector<Tile> filled = pool;
+                std::vector<int> used = counts;
+                int picks[2] = {a, b};
+                bool fits = true;
+                for (int j = 0; j < jokers; ++j) {
+                    int kind = jokers == 1 ? a : picks[j];
+                    fits &= ++used[kind] <= 2;
+                    filled.push_back(Tile(TileCode::kindNumber(kind), TileCode::kindColor(kind), used[kind] - 1));
+                }
+                if (fits && ArrangementSolver::is_arrangeable(filled)) {
+                    return true;
+                }
+                if (jokers == 1) {
+                    break;
+                }
+            }
+        }
+        return false;
+    };
+    int feasible = 0;
+    for (int iteration = 0; iteration < 60; ++iteration) {
+        std::vector<Tile> deck = allTiles;
+        std::shuffle(deck.begin(), deck.end(), rng);
+        int jokers = iteration < 45 ? 1 : 2;
+        std::vector<Tile> pool;
+        if (iteration % 2 == 0) {
+            // Drop tiles from a few catalog sets, so feasible pools are common.
+            for (int s = 0; s < 2; ++s) {
+                const auto& entry = SetFinder::CATALOG[rng() % SetFinder::CATALOG_SIZE];
+                for (TileCode::KindMask rest = entry.mask; rest != 0; rest &= rest - 1) {
+                    int kind = __builtin_ctzll(rest);
+                    Tile tile(TileCode::kindNumber(kind), TileCode::kindColor(kind), s);
+                    if (std::find(pool.begin(), pool.end(), tile) == pool.end()) {
+                        pool.push_back(tile);
+                    }
+                }
+            }
+            pool.erase(pool.begin() + rng() % pool.size());
+            if (jokers == 2) {
+                pool.erase(pool.begin() + rng() % pool.size());
+            }
+        } else {
+            pool.assign(deck.begin(), deck.begin() + 2 + iteration % 6);
+        }
+        bool expected = by_substitution(pool, jokers);
+        std::vector<Tile> with_jokers = pool;
+        with_jokers.push_back(J);
+        if (jokers == 2) {
+            with_jokers.push_back(J2);
+        }
+        assert(ArrangementSolver::is_arrangeable(with_jokers) == expected);
+        std::optional<std::vector<GameSet>> arrangement = ArrangementSolver::solve(with_jokers);
+        assert(arrangement.has_value() == expected);
+        if (arrangement) {
+            assert(is_board_valid(*arrangement));
+            std::vector<Tile> placed;
+            for (const auto& set : *arrangement) {
+                placed.insert(placed.end(), set.tiles.begin(), set.tiles.end());
+            }
+            std::sort(placed.begin(), placed.end());
+            std::sort(with_jokers.begin(), with_jokers.end());
+            assert(placed == with_jokers);
+            ++feasible;
+        }
+    }
+    assert(feasible > 10);
+    std::cout << "TC3 Wildcard DP matches substitution (" << feasible << " feasible): Passed" << std::endl;
+
+    // Jokers in the hand are played like any other tile; jokers on the board must stay placed.
+    BoardState board({GameSet({Tile(1, red), Tile(2, red), Tile(3, red)}, SetType::RUN)});
+    std::optional<Move> move = MoveFinder::find_best_move(board, {J, Tile(7, blue)});
+    assert(move && move->tiles_played_count == 1 && move->remaining_hand == std::vector<Tile>({Tile(7, blue)}));
+    assert(move->new_board_state.isValidBoard() && move->new_board_state.getAllTiles().size() == 4);
+
+    BoardState joker_board({GameSet({Tile(8, red), J, Tile(10, red)}, SetType::RUN)});
+    move = MoveFinder::find_best_move(joker_board, {Tile(9, red), Tile(11, red), Tile(2, blue)});
+    assert(move && move->tiles_played_count == 2 && move->new_board_state.isValidBoard());
+    std::vector<Tile> after = move->new_board_state.getAllTiles();
+    assert(std::find(after.begin(), after.end(), J) != after.end());
+
+    // A joker counts as the tile it stands for towards the initial meld.
+    ArrangementSolver::PoolCounts none{};
+    ArrangementSolver::PoolCounts hand = *ArrangementSolver::to_counts({Tile(10, red), Tile(11, red), J, Tile(2, blue)});
+    int meld_points = 0;
+    ArrangementSolver::max_playable(none, hand, ArrangementSolver::Objective::POINTS, &meld_points);
+    assert(meld_points == 10 + 11 + 12);
+    std::cout << "TC4 Jokers in moves and melds: Passed" << std::endl;
+
+    std::cout << "--- Joker Tests Passed ---" << std::endl;
+}
+
+void testBenchmark() {
+    TRACE_FUNCTION();
+    std::cout << "\n--- Testing Benchmark harness ---" << std::endl;
+
+    // TC1: Generated positions hold a valid board of about the requested size and a hand
+    // of the requested size, with no physical tile in both.
+    std::mt19937_64 rng(77);
+    for (int board_tiles : {0, 15, 45, 90}) {
+        for (int hand_size : {1, 14, 20}) {
+            Benchmark::Position position = Benchmark::random_position(board_tiles, hand_size, rng);
+            std::vector<Tile> board = sorted(position.board.getAllTiles());
+            assert(position.board.isValidBoard());
+            assert(static_cast<int>(board.size()) <= board_tiles && static_cast<int>(board.size()) + 3 > board_tiles);
+            assert(position.hand.size() == std::min<size_t>(hand_size, allTiles.size() - board.size()));
+            std::vector<Tile> shared;
+            std::set_intersection(board.begin(), board.end(), position.hand.begin(), position.hand.end(),
+                                  std::back_inserter(shared));
+            assert(shared.empty());
+        }
+    }
+    std::cout << "TC1 Random positions: Passed" << std::endl;
+
+    // TC2: measure() runs every call it reports and derives the rates from one total.
+    uint64_t calls = 0;
+    Benchmark::Result result = Benchmark::measure("count", "", 0.001, [&](uint64_t) { ++calls; });
+    assert(result.operations > 0 && result.operations < calls);
+    assert(result.ns_per_op > 0 && std::abs(result.ns_per_op * result.ops_per_second - 1e9) < 1e3);
+    assert(result.p50_ns <= result.p90_ns && result.p90_ns <= result.p99_ns && result.p99_ns <= result.max_ns);
+    assert(result.allocations_per_op == 0); // The harness's own bookkeeping is not counted.
+    std::cout << "TC2 Measurement: Passed" << std::endl;
+
+    std::cout << "--- Benchmark harness Tests Passed ---" << std::endl;
+}
+
+void tracedLeaf(double spin_nanoseconds = 0) {
+    TRACE_SCOPE_ALWAYS("tracer test leaf");
+    auto start = std::chrono::steady_clock::now();
+    while (std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() < spin_nanoseconds) {
+    }
+}
+
+void tracedRecursion(int depth) {
+    TRACE_SCOPE_ALWAYS("tracer test recursion");
+    if (depth > 0) {
+        tracedRecursion(depth - 1);
+    } else {
+        tracedLeaf(20000);
+    }
+}
+
+// Run by "./test trace-workers-then-exit" in a fresh process: the pool is built before the
+// first traced scope creates the tracer's registry, so the workers' thread-local state is
+// only torn down when the pool's static destructor joins them, after the registry's.
+int traceWorkersThenExit() {
+    static ThreadPool pool(3);
+    std::atomic<int> arrived{0};
+    pool.parallel_for(3, 1, [&](size_t) {
+        tracedLeaf();
+        arrived.fetch_add(1);
+        while (arrived.load() < 3) { // Holds each thread to one chunk, so all three trace.
+            std::this_thread::yield();
+        }
+    });
+    return 0;
+}
+
+const PerformanceTracer::CallNode* findCallNode(const PerformanceTracer::CallNode& node, const std::string& name) {
+    if (node.name == name) {
+        return &node;
+    }
+    for (const auto& child : node.children) {
+        if (const PerformanceTracer::CallNode* found = findCallNode(child, name)) {
+            return found;
+        }
+    }
+    return nullptr;
+}
+
+void testPerformanceTracer() {
+    TRACE_FUNCTION();
+    std::cout << "\n--- Testing PerformanceTracer ---" << std::endl;
+
+    auto calls_of = [](const std::string& name) {
+        for (const auto& profile : PerformanceTracer::snapshot()) {
+            if (profile.name == name) {
+                return profile.call_count;
+            }
+        }
+        return uint64_t(0);
+    };
+
+    // TC1: Scopes with the same name share one id; other names do not.
+    PerformanceTracer::Scope a("tracer test leaf"), b("tracer test leaf"), c("tracer test other");
+    assert(a.id() == b.id() && a.id() != c.id());
+    std::cout << "TC1 Static scope ids: Passed" << std::endl;
+
+    // TC2: Counts from pool workers and from threads that have already exited are merged.
+    uint64_t before = calls_of("tracer test leaf");
+    ThreadPool pool(4);
+    pool.parallel_for(1000, 7, [](size_t) { tracedLeaf(); });
+    std::thread short_lived([] {
+        for (int i = 0; i < 500; ++i) {
+            tracedLeaf();
+        }
+    });
+    short_lived.join();
+    tracedLeaf();
+    assert(calls_of("tracer test leaf") == before + 1501);
+    std::cout << "TC2 Thread-local counters merged at report time: Passed" << std::endl;
+
+    // TC3: A traced scope costs tens of nanoseconds: two time-stamp reads and a little
+    // bookkeeping (about 55 ns on the reference machine, where one rdtsc takes 18 ns). The
+    // fastest of several batches is kept, so a descheduled batch does not fail the bound.
+    const int calls = 200000;
+    double per_call = std::numeric_limits<double>::max();
+    for (int batch = 0; batch < 5; ++batch) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < calls; ++i) {
+            TRACE_SCOPE_ALWAYS("tracer test overhead");
+            Benchmark::keep(i);
+        }
+        per_call = std::min(per_call, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / calls);
+    }
+    assert(per_call < 100);
+    std::cout << "TC3 Per-scope overhead (" << std::fixed << std::setprecision(1) << per_call << " ns): Passed" << std::endl;
+
+    // TC4: The call tree nests callees under their callers and folds recursion, so each
+    // level of inclusive time is counted once and exclusive time is what the children leave.
+    for (int i = 0; i < 10; ++i) {
+        TRACE_SCOPE_ALWAYS("tracer test outer");
+        tracedRecursion(5);
+    }
+    PerformanceTracer::CallNode tree = PerformanceTracer::call_tree();
+    const PerformanceTracer::CallNode* outer = findCallNode(tree, "tracer test outer");
+    assert(outer && outer->call_count == 10 && outer->children.size() == 1);
+    const PerformanceTracer::CallNode& recursion = outer->children[0];
+    assert(recursion.name == "tracer test recursion" && recursion.call_count == 60);
+    assert(recursion.children.size() == 1 && recursion.children[0].name == "tracer test leaf");
+    assert(recursion.children[0].call_count == 10);
+    assert(recursion.inclusive_nanoseconds <= outer->inclusive_nanoseconds);
+    assert(recursion.children[0].inclusive_nanoseconds >= 10 * 20000);
+    assert(outer->exclusive_nanoseconds + recursion.inclusive_nanoseconds == outer->inclusive_nanoseconds);
+    for (const auto& profile : PerformanceTracer::snapshot()) {
+        if (profile.name == "tracer test recursion") {
+            // Within the drift of the tick calibration between the two reports.
+            assert(std::abs(static_cast<double>(profile.total_nanoseconds) - recursion.inclusive_nanoseconds) <=
+                   0.01 * recursion.inclusive_nanoseconds);
+            assert(profile.exclusive_nanoseconds <= profile.total_nanoseconds);
+        }
+    }
+    std::cout << "TC4 Call tree with folded recursion: Passed" << std::endl;
+
+    // TC5: While the timeline records, every timed frame of every thread becomes a nested
+    // B/E pair; folded stacks list call paths with their exclusive time.
+    auto occurrences = [](const std::string& text, const std::string& pattern) {
+        size_t count = 0;
+        for (size_t at = text.find(pattern); at != std::string::npos; at = text.find(pattern, at + 1)) {
+            ++count;
+        }
+        return count;
+    };
+    PerformanceTracer::start_timeline();
+    tracedRecursion(3);
+    std::thread recorded([] {
+        tracedLeaf();
+        tracedLeaf();
+    });
+    recorded.join();
+    PerformanceTracer::stop_timeline();
+    tracedLeaf(); // Not recorded.
+
+    std::ostringstream chrome;
+    PerformanceTracer::write_chrome_trace(chrome);
+    std::string trace = chrome.str();
+    assert(trace.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[") == 0);
+    assert(occurrences(trace, "\"name\":\"tracer test recursion\",\"ph\":\"B\"") == 1); // Recursion folded.
+    assert(occurrences(trace, "\"name\":\"tracer test leaf\",\"ph\":\"B\"") == 3);
+    assert(occurrences(trace, "\"ph\":\"B\"") == occurrences(trace, "\"ph\":\"E\""));
+    size_t recursion_begin = trace.find("\"name\":\"tracer test recursion\",\"ph\":\"B\"");
+    assert(trace.find("\"name\":\"tracer test leaf\",\"ph\":\"B\"", recursion_begin) != std::string::npos);
+
+    std::ostringstream folded;
+    PerformanceTracer::write_folded_stacks(folded);
+    assert(folded.str().find("tracer test outer;tracer test recursion;tracer test leaf ") != std::string::npos);
+    std::cout << "TC5 Chrome trace and folded stacks: Passed" << std::endl;
+
+    // TC6: Hardware counters are read around frames where perf allows it; elsewhere the
+    // tracer reports them unavailable and keeps timing.
+    bool counting = PerformanceTracer::enable_hardware_counters();
+    assert(counting == (PerformanceTracer::available_counters() != 0));
+    uint64_t leaf_calls = calls_of("tracer test leaf");
+    {
+        TRACE_SCOPE_ALWAYS("tracer test counted");
+        tracedLeaf(100000);
+    }
+    assert(calls_of("tracer test leaf") == leaf_calls + 1);
+    for (const auto& profile : PerformanceTracer::snapshot()) {
+        if (profile.name == "tracer test counted") {
+            uint32_t available = PerformanceTracer::available_counters();
+            for (int counter = 0; counter < PerformanceTracer::NUM_COUNTERS; ++counter) {
+                assert((available & (1u << counter)) || profile.counters[counter] == 0);
+            }
+            assert(!(available & (1u << PerformanceTracer::INSTRUCTIONS)) || profile.counters[PerformanceTracer::INSTRUCTIONS] > 0);
+        }
+    }
+#ifndef ENABLE_HARDWARE_COUNTERS
+    PerformanceTracer::disable_hardware_counters();
+#endif
+    std::cout << "TC6 Hardware counters (" << (counting ? "available" : "unavailable") << "): Passed" << std::endl;
+
+    // TC7: With the allocation hook, allocations are charged to the innermost active scope
+    // and roll up into the callers' inclusive totals; without it nothing is counted.
+    PerformanceTracer::AllocationTotals allocations_before = PerformanceTracer::thread_allocations;
+    {
+        TRACE_SCOPE_ALWAYS("tracer test allocating");
+        std::vector<std::unique_ptr<int>> owned;
+        owned.reserve(8);
+        for (int i = 0; i < 8; ++i) {
+            owned.push_back(std::make_unique<int>(i));
+        }
+        {
+            TRACE_SCOPE_ALWAYS("tracer test allocating child");
+            std::vector<int> buffer(1000);
+            Benchmark::keep(buffer);
+        }
+    }
+    uint64_t scope_allocations = PerformanceTracer::thread_allocations.count - allocations_before.count;
+    PerformanceTracer::CallNode allocation_tree = PerformanceTracer::call_tree();
+    const PerformanceTracer::CallNode* allocating = findCallNode(allocation_tree, "tracer test allocating");
+    assert(allocating && allocating->children.size() == 1);
+    if (PerformanceTracer::allocation_hook_installed) {
+        assert(scope_allocations == 10);
+        assert(allocating->exclusive_allocations == 9 && allocating->allocations == 10);
+        assert(allocating->children[0].allocations == 1 && allocating->children[0].allocated_bytes == 1000 * sizeof(int));
+        assert(allocating->allocated_bytes == 8 * sizeof(std::unique_ptr<int>) + 8 * sizeof(int) + 1000 * sizeof(int));
+    } else {
+        assert(scope_allocations == 0 && allocating->allocations == 0);
+    }
+    std::cout << "TC7 Allocations per scope (hook " << (PerformanceTracer::allocation_hook_installed ? "installed" : "not installed")
+              << "): Passed" << std::endl;
+
+    // TC8: A process whose pool workers traced exits cleanly, whichever of the pool and the
+    // tracer's registry was built first.
+    pid_t child = fork();
+    assert(child >= 0);
+    if (child == 0) {
+        char mode[] = "trace-workers-then-exit";
+        char* args[] = {mode, mode, nullptr};
+        execv("/proc/self/exe", args);
+        _exit(127);
+    }
+    int status = 0;
+    assert(waitpid(child, &status, 0) == child);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    std::cout << "TC8 Exit after tracing on pool workers: Passed" << std::endl;
+
+    std::cout << "--- PerformanceTracer Tests Passed ---" << std::endl;
+}
+
+// Cross-checks the DP arrangement solver against the reference backtracker.
+void testArrangementSolver() {
+    TRACE_FUNCTION();
+    std::cout << "\n--- Testing ArrangementSolver ---" << std::endl;
+
+    std::mt19937 rng(2015);
+    int feasible_pools = 0;
+    for (int iteration = 0; iteration < 400; ++iteration) {
+        std::vector<Tile> pool;
+        if (iteration % 2 == 0) {
+            // Random tiles: mostly infeasible pools.
+            std::vector<Tile> deck = allTiles;
+            std::shuffle(deck.begin(), deck.end(), rng);
+            pool.assign(deck.begin(), deck.begin() + 3 + iteration % 7);
+        } else {
+            // Union of random catalog sets, using the second copy when the first is taken.
+            std::vector<int> used(TileCode::NUM_KINDS, 0);
+            // Kept small: the reference backtracker is exponential.
+            for (int n = 0; n < 1 + iteration % 3 && pool.size() < 7; ++n) {
+                const auto& entry = SetFinder::CATALOG[rng() % SetFinder::CATALOG_SIZE];
+                for (const auto& tile : SetFinder::to_game_set(entry).tiles) {
+                    if (used[tile.getKind()] < 2) {
+                        pool.push_back(Tile(tile.getNumber(), tile.getColor(), used[tile.getKind()]++));
+                    }
+                }
+            }
+        }
+
+        BoardState empty_board;
+        std::optional<BoardState> reference = BoardManipulation::can_add_tiles_to_board_reference(empty_board, pool);
+        std::optional<BoardState> actual = BoardManipulation::can_add_tiles_to_board(empty_board, pool);
+        assert(ArrangementSolver::is_arrangeable(pool) == reference.has_value());
+        assert(actual.has_value() == reference.has_value());
+        if (reference) {
+            ++feasible_pools;
+            assert(areBoardStatesEquivalent(*actual, *reference, true));
+
+            std::optional<std::vector<GameSet>> solved = ArrangementSolver::solve(pool);
+            assert(solved.has_value() && is_board_valid(*solved));
+            assert(BoardState(*solved).getAllTiles() == sorted(pool));
+        } else {
+            assert(!ArrangementSolver::solve(pool).has_value());
+        }
+    }
+    assert(feasible_pools > 50);
+    std::cout << "TC1 DP agrees with reference backtracker on " << feasible_pools << " feasible pools: Passed" << std::endl;
+
+    // Two copies of one kind can be placed in two different sets.
+    std::vector<Tile> doubled = {Tile(1,red), Tile(2,red), Tile(3,red), Tile(1,red,1), Tile(1,blue), Tile(1,yellow)};
+    std::optional<std::vector<GameSet>> doubled_solution = ArrangementSolver::solve(doubled);
+    assert(doubled_solution.has_value() && doubled_solution->size() == 2 && is_board_valid(*doubled_solution));
+    std::cout << "TC2 Both copies of a kind: Passed" << std::endl;
+
+    // A full deck is arrangeable, and so is one missing a 1 (B1-B13 plus B2-B13).
+    // A tile outside the 52 kinds can never be placed.
+    assert(ArrangementSolver::is_arrangeable(allTiles));
+    std::vector<Tile> almost_all(allTiles.begin() + 1, allTiles.end());
+    assert(ArrangementSolver::solve(almost_all).has_value());
+    std::vector<Tile> with_off_color = allTiles;
+    with_off_color.push_back(Tile(5, 0));
+    assert(!ArrangementSolver::is_arrangeable(with_off_color));
+    std::cout << "TC3 Full deck: Passed" << std::endl;
+
+    std::cout << "--- ArrangementSolver Tests Passed ---" << std::endl;
+}
+
+void testTranspositionTable() {
+    TRACE_FUNCTION();
+    std::cout << "\n--- Testing TranspositionTable ---" << std::endl;
+
+    // Keys ignore order and copies.
+    std::vector<Tile> pool_a = {Tile(1,red), Tile(2,red,1), Tile(9,blue)};
+    std::vector<Tile> pool_b = {Tile(9,blue), Tile(2,red), Tile(1,red,1)};
+    assert(pool_key(pool_a) == pool_key(pool_b));
+    assert(pool_key(pool_a) != pool_key({Tile(1,red), Tile(2,red)}));
+    std::cout << "TC1 Canonical pool key: Passed" << std::endl;
+
+    // Capacity rounds up; the replacement policy decides who keeps a contested slot.
+    TranspositionTable keep_larger(3, ReplacementPolicy::PREFER_LARGER_POOL);
+    assert(keep_larger.capacity() == 4);
+    keep_larger.store_infeasible(1, 10);
+    keep_larger.store_infeasible(5, 4); // same slot, smaller pool: dropped
+    assert(keep_larger.probe_infeasible(1) && !keep_larger.probe_infeasible(5));
+    TranspositionTable always(4, ReplacementPolicy::ALWAYS_REPLACE);
+    always.store_infeasible(1, 10);
+    always.store_infeasible(5, 4);
+    assert(!always.probe_infeasible(1) && always.probe_infeasible(5));
+    assert(always.stats().evictions == 1 && always.stats().hits == 1 && always.stats().misses == 1);
+    std::cout << "TC2 Size bound and replacement policy: Passed" << std::endl;
+
+    // Memoized search returns the same boards as the plain search, and reuses work.
+    std::mt19937 rng(77);
+    TranspositionTable shared;
+    for (int iteration = 0; iteration < 40; ++iteration) {
+        // Overlapping sets plus a stray tile: many orders of sets reach the same sub-pools.
+        std::vector<Tile> pool;
+        std::vector<int> used(TileCode::NUM_KINDS, 0);
+        for (int n = 0; n < 3 && pool.size() < 12; ++n) {
+            const auto& entry = SetFinder::CATALOG[rng() % SetFinder::CATALOG_SIZE];
+            for (const auto& tile : SetFinder::to_game_set(entry).tiles) {
+                if (used[tile.getKind()] < 2) {
+                    pool.push_back(Tile(tile.getNumber(), tile.getColor(), used[tile.getKind()]++));
+                }
+            }
+        }
+        if (iteration % 2 == 0 && used[0] < 2) {
+            pool.push_back(Tile(1, blue, used[0]));
+        }
+        BoardState empty_board;
+        std::optional<BoardState> memoized = BoardManipulation::can_add_tiles_to_board_reference(empty_board, pool, &shared);
+        std::optional<BoardState> direct = BoardManipulation::can_add_tiles_to_board(empty_board, pool);
+        assert(memoized.has_value() == direct.has_value());
+        if (memoized) {
+            assert(areBoardStatesEquivalent(*memoized, *direct, true));
+        }
+    }
+    assert(shared.stats().hits > 0 && shared.stats().stores > 0);
+    std::cout << "TC3 Memoized reference search (" << shared.stats().hits << " hits, "
+              << shared.stats().misses << " misses): Passed" << std::endl;
+
+    std::cout << "--- TranspositionTable Tests Passed ---" << std::endl;
+}
+
+void testArena() {
+    TRACE_FUNCTION();
+    std::cout << "\n--- Testing Arena ---" << std::endl;
+
+    // TC1: A scope releases everything allocated inside it, and scopes nest.
+    Arena arena(1024);
+    {
+        Arena::Scope outer(arena);
+        std::pmr::vector<Tile> kept(outer.resource());
+        kept.reserve(100);
+        size_t after_outer = arena.bytes_in_use();
+        assert(after_outer >= 100);
+        {
+            Arena::Scope inner(arena);
+            std::pmr::vector<uint64_t> scratch(50, 0, inner.resource());
+            assert(arena.bytes_in_use() >= after_outer + 50 * sizeof(uint64_t));
+            assert(reinterpret_cast<uintptr_t>(scratch.data()) % alignof(uint64_t) == 0);
+        }
+        assert(arena.bytes_in_use() == after_outer);
+    }
+    assert(arena.bytes_in_use() == 0 && arena.peak_bytes() >= 500 && arena.overflows() == 0);
+    std::cout << "TC1 Nested scopes: Passed" << std::endl;
+
+    // TC2: Allocations past the capacity come from the heap until the outermost scope closes.
+    arena.reset_peak();
+    {
+        Arena::Scope outer(arena);
+        {
+            Arena::Scope inner(arena);
+            std::pmr::vector<uint8_t> big(2000, 7, inner.resource());
+            assert(big[1999] == 7 && arena.overflows() == 1);
+        }
+        assert(arena.bytes_in_use() > 2000); // Still held by the outer scope.
+    }
+    assert(arena.bytes_in_use() == 0 && arena.peak_bytes() > 2000 && arena.overflows() == 1);
+    std::cout << "TC2 Overflow to heap: Passed" << std::endl;
+
+    // TC3: The searches hand their scratch memory back and stay within the thread's buffer.
+    Arena& local = Arena::local();
+    local.reset_peak();
+    std::mt19937_64 rng(2024);
+    for (int board_tiles : {0, 12, 30, 90}) {
+        Benchmark::Position position = Benchmark::random_position(board_tiles, 3, rng);
+        BoardManipulation::can_add_tiles_to_board(position.board, position.hand);
+        BoardManipulation::can_add_tiles_to_board(position.board, position.hand, false);
+        if (board_tiles <= 12) {
+            BoardManipulation::can_add_tiles_to_board_reference(position.board, position.hand);
+        }
+        assert(position.board.isValidBoard());
+        assert(local.bytes_in_use() == 0);
+    }
+    assert(local.peak_bytes() > 0 && local.peak_bytes() <= local.capacity() && local.overflows() == 0);
+    std::cout << "TC3 Search scratch released (peak " << local.peak_bytes() << " bytes): Passed" << std::endl;
+
+    std::cout << "--- Arena Tests Passed ---" << std::endl;
+}
+
 // Newly added test suite for find_best_move
 void testFindBestMove() {
     TRACE_FUNCTION();
@@ -481,26 +1810,178 @@ void testFindBestMove() {
     assert(move6.has_value() && move6->tiles_played_count == 5 && move6->remaining_hand.empty());
     if(move6){BoardState exp; exp.addSet(GameSet({r1,r2,r3,r4},SetType::RUN)); exp.addSet(GameSet({b4_b,b5_b,b6_b,b7_b},SetType::RUN)); exp.addSet(GameSet({y10,y11,y12},SetType::RUN)); assert(areBoardStatesEquivalent(move6->new_board_state,exp,true));}
     std::cout << "find_best_move TC6 (Many board, many hand - complex): Passed" << std::endl;
+    // TC7: Single-pass optimizer agrees with probing every subset of the hand.
+    std::mt19937 rng(1604);
+    for (int iteration = 0; iteration < 60; ++iteration) {
+        std::vector<Tile> deck = allTiles;
+        std::shuffle(deck.begin(), deck.end(), rng);
+        std::vector<Tile> board_tiles(deck.begin(), deck.begin() + 12);
+        std::optional<std::vector<GameSet>> board_sets = ArrangementSolver::solve(board_tiles);
+        BoardState board = board_sets ? BoardState(*board_sets) : BoardState();
+        std::vector<Tile> hand(deck.begin() + 12, deck.begin() + 12 + 3 + iteration % 6);
+
+        std::optional<Move> fast = MoveFinder::find_best_move(board, hand);
+        std::optional<Move> reference = MoveFinder::find_best_move_by_subsets(board, hand);
+        assert(fast.has_value() == reference.has_value());
+        if (fast) {
+            assert(fast->tiles_played_count == reference->tiles_played_count);
+            assert(fast->new_board_state.isValidBoard());
+            assert(fast->new_board_state.getAllTiles().size() == board.getAllTiles().size() + fast->tiles_played_count);
+        }
+    }
+    std::cout << "find_best_move TC7 (Matches subset probing on random positions): Passed" << std::endl;
+
+    // TC8: The parallel search returns exactly the serial Move, including on boards large
+    // enough for its layout probes to run concurrently.
+    ThreadPool four_threads(4);
+    std::mt19937_64 position_rng(707);
+    for (int iteration = 0; iteration < 30; ++iteration) {
+        Benchmark::Position position = Benchmark::random_position(20 + 2 * iteration, 4 + iteration % 10, position_rng);
+        const BoardState& board = position.board;
+        const std::vector<Tile>& hand = position.hand;
+        std::optional<Move> serial = MoveFinder::find_best_move(board, hand);
+        std::optional<Move> parallel = MoveFinder::find_best_move_parallel(board, hand, four_threads);
+        assert(serial.has_value() == parallel.has_value());
+        if (serial) {
+            assert(*serial == *parallel);
+        }
+    }
+    std::optional<Move> shared_pool_move = MoveFinder::find_best_move_parallel(cb6, hand6);
+    assert(shared_pool_move.has_value() && shared_pool_move->tiles_played_count == 5);
+    std::cout << "find_best_move TC8 (Parallel matches the serial Move): Passed" << std::endl;
+
+    // TC9: The subset prober rejects hands too large to enumerate instead of shifting past
+    // the width of its masks; find_best_move has no such limit.
+    std::vector<Tile> big_hand(allTiles.begin(), allTiles.begin() + MoveFinder::MAX_SUBSET_HAND_SIZE + 1);
+    assert(MoveFinder::generate_tile_subsets_descending(big_hand).empty());
+    assert(!MoveFinder::find_best_move_by_subsets(BoardState(), big_hand).has_value());
+    std::optional<Move> big_move = MoveFinder::find_best_move(BoardState(), big_hand);
+    assert(big_move.has_value() && big_move->tiles_played_count > 0);
+    std::cout << "find_best_move TC9 (Subset prober bounds the hand size): Passed" << std::endl;
     std::cout << "--- MoveFinder::find_best_move ALL CASES PASSED ---" << std::endl;
 }
 
+void testFindBestMoveAnytime() {
+    TRACE_FUNCTION();
+    std::cout << "\n--- Testing MoveFinder::find_best_move_anytime ---" << std::endl;
+
+    // TC1: Without limits the search finishes and agrees with find_best_move.
+    std::mt19937_64 rng(22);
+    std::vector<Benchmark::Position> positions;
+    std::vector<std::optional<Move>> expected;
+    for (int iteration = 0; iteration < 20; ++iteration) {
+        positions.push_back(Benchmark::random_position(iteration * 5, 1 + iteration % 14, rng));
+        expected.push_back(MoveFinder::find_best_move(positions.back().board, positions.back().hand));
+        MoveFinder::SearchResult result = MoveFinder::find_best_move_anytime(positions.back().board, positions.back().hand, {});
+        assert(result.proven_optimal && result.nodes > 0);
+        assert(result.move.has_value() == expected.back().has_value());
+        if (result.move) {
+            assert(*result.move == *expected.back());
+        }
+    }
+    std::cout << "TC1 Unlimited search matches find_best_move: Passed" << std::endl;
+
+    // TC2: A node budget too small for one sweep still returns the hand's own sets.
+    Tile r1(1,red), r2(2,red), r3(3,red), b5(5,blue), b6(6,blue), b7(7,blue), b8(8,blue), y9(9,yellow);
+    MoveFinder::SearchLimits one_node;
+    one_node.max_nodes = 1;
+    MoveFinder::SearchResult cut = MoveFinder::find_best_move_anytime(BoardState(), {r1,r2,r3,b5,b6,b7,b8,y9}, one_node);
+    assert(!cut.proven_optimal && cut.nodes == 1);
+    assert(cut.move.has_value() && cut.move->tiles_played_count == 7 && cut.move->remaining_hand == std::vector<Tile>{y9});
+    assert(cut.move->new_board_state.isValidBoard() && cut.move->new_board_state.sets.size() == 2);
+    std::cout << "TC2 Node budget falls back to the hand's sets: Passed" << std::endl;
+
+    // TC3: A deadline already passed stops before the first node; any fallback is legal.
+    MoveFinder::SearchLimits expired;
+    expired.deadline = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < positions.size(); ++i) {
+        MoveFinder::SearchResult late = MoveFinder::find_best_move_anytime(positions[i].board, positions[i].hand, expired);
+        assert(late.nodes == 0 && !late.proven_optimal);
+        if (late.move) {
+            assert(late.move->new_board_state.isValidBoard());
+            assert(expected[i] && late.move->tiles_played_count <= expected[i]->tiles_played_count);
+            assert(late.move->new_board_state.getAllTiles().size() ==
+                   positions[i].board.getAllTiles().size() + late.move->tiles_played_count);
+        }
+    }
+    std::cout << "TC3 Expired deadline returns a legal fallback: Passed" << std::endl;
+
+    // TC4: Searches cut short leave nothing behind for the next one.
+    for (size_t i = 0; i < positions.size(); ++i) {
+        std::optional<Move> again = MoveFinder::find_best_move(positions[i].board, positions[i].hand);
+        assert(again.has_value() == expected[i].has_value() && (!again || *again == *expected[i]));
+    }
+    std::cout << "TC4 Interrupted sweeps do not disturb later searches: Passed" << std::endl;
+
+    // TC5: A budget that covers the tile choice but not the canonical layout still returns
+    // the optimal number of tiles, laid out as the DP arranged them.
+    size_t laid_out = 0;
+    for (size_t i = 0; i < positions.size(); ++i) {
+        if (!expected[i]) {
+            continue;
+        }
+        ArrangementSolver::Budget choice;
+        {
+            Arena::Scope scratch;
+            std::pmr::vector<Tile> played(scratch.resource());
+            assert(MoveFinder::choose_tiles_to_play(positions[i].board, positions[i].hand, played,
+                                                    scratch.resource(), &choice));
+        }
+        MoveFinder::SearchLimits choice_only;
+        choice_only.max_nodes = choice.nodes() + 1;
+        MoveFinder::SearchResult result = MoveFinder::find_best_move_anytime(positions[i].board, positions[i].hand, choice_only);
+        assert(result.proven_optimal && result.nodes == choice_only.max_nodes && result.move);
+        assert(result.move->tiles_played_count == expected[i]->tiles_played_count);
+        assert(result.move->remaining_hand == expected[i]->remaining_hand);
+        assert(result.move->new_board_state.isValidBoard());
+        assert(sorted(result.move->new_board_state.getAllTiles()) == sorted(expected[i]->new_board_state.getAllTiles()));
+        ++laid_out;
+    }
+    assert(laid_out > 0);
+    std::cout << "TC5 Budget spent during layout keeps the optimal move: Passed" << std::endl;
+
+    std::cout << "--- MoveFinder::find_best_move_anytime Tests Passed ---" << std::endl;
+}
+
 
 // Original main function modified to include all tests
-int main() {
+int main( int argc, char **argv ) {
+	if( argc > 1 && std::strcmp( argv[1], "trace-workers-then-exit" ) == 0 ) {
+		return traceWorkersThenExit();
+	}
+
 	assert( allTiles.size() == 104 );
 	std::cout << "Initial tile generation test passed." << std::endl;
 
+	testTileEncoding();
+
 	testBoardStructures();
+	testGameSetLayout();
     std::cout << "\nAttempting to run SetFinder tests..." << std::endl;
 	testSetFinder();
     std::cout << "\nAttempting to run isValidBoard tests..." << std::endl;
     testIsValidBoard();
     std::cout << "\nAttempting to run is_board_valid (free function) tests..." << std::endl;
     testIsBoardValidFunction();
+    testBoardStateEdits();
     std::cout << "\nAttempting to run can_add_tiles_to_board tests..." << std::endl;
     testCanAddTilesToBoard(); // This now uses std::optional and its assertions are updated.
+    testZobrist();
+    testArrangementSolver();
+    testTranspositionTable();
+    testArena();
+    testExactCover();
 
+    testThreadPool();
     testFindBestMove(); // Added call to new test suite
+    testFindBestMoveAnytime();
+    testAnalyzer();
+    testGame();
+    testTournament();
+    testJokers();
+    testSetValidator();
+    testBenchmark();
+    testPerformanceTracer();
 
 #ifdef ENABLE_PERFORMANCE_TRACING
     PerformanceTracer::print_performance_report();
@@ -74,9 +74,17 @@ auto isYellow = []( Tile t ) {
 	return t.getColor() == color::yellow;
 };
 
-template<typename T>
-void shuffle( T iterable ) {
-	random_shuffle( iterable->begin(), iterable->end() );
+/*
+ * Fisher-Yates shuffle driven by rng (e.g. mt19937_64). The order depends only on the
+ * generator's output, unlike std::shuffle, so a seed gives the same order everywhere.
+ * @param T iterable
+ * @param Rng& rng
+ */
+template<typename T, typename Rng>
+void shuffle( T iterable, Rng &rng ) {
+	for( size_t i = iterable->size(); i > 1; i-- ) {
+		swap( ( *iterable )[i - 1], ( *iterable )[rng() % i] );
+	}
 }
 
 /*
@@ -120,9 +128,9 @@ vector<Tile> generateAllTiles() {
 
 	for( int i = 1; i <= 4; i++ ) {
 		for( int j = 1; j <= 13; j++ ) {
-			Tile t1 = Tile( j, i );
+			Tile t1 = Tile( j, i, 0 );
 			result.push_back( t1 );
-			Tile t2 = Tile( j, i );
+			Tile t2 = Tile( j, i, 1 );
 			result.push_back( t2 );
 		}
 	}